@@ -0,0 +1,270 @@
+#include <string.h>
+#include <ctl_api.h>
+#include <SDlib.h>
+#include "SDcache.h"
+#include "SDtask.h"
+#include "SDstream.h"
+
+//cache line state
+typedef struct{
+  unsigned long addr;
+  //time of last use for LRU replacement
+  unsigned long used;
+  unsigned char valid,dirty;
+}CACHE_LINE;
+
+static CACHE_LINE lines[SD_CACHE_LINES];
+static unsigned char cache_dat[SD_CACHE_LINES][512];
+static SD_CACHE_STATS stats;
+static unsigned long use_count;
+static int enabled=1;
+//cache can be used from more then one task
+static CTL_MUTEX_t cache_mutex;
+
+//initialize the cache
+void cache_init(void){
+  memset(lines,0,sizeof(lines));
+  ctl_mutex_init(&cache_mutex);
+}
+
+//find a line holding addr, returns -1 if not found
+static int cache_find(unsigned long addr){
+  int i;
+  for(i=0;i<SD_CACHE_LINES;i++){
+    if(lines[i].valid && lines[i].addr==addr){
+      return i;
+    }
+  }
+  return -1;
+}
+
+//write a line to the card if it is dirty
+static int cache_writeback(int i){
+  int resp;
+  if(!lines[i].valid || !lines[i].dirty){
+    return MMC_SUCCESS;
+  }
+  resp=SD_write(lines[i].addr,1,cache_dat[i],SD_PRI_HIGH);
+  if(resp==MMC_SUCCESS){
+    lines[i].dirty=0;
+    stats.writebacks++;
+  }
+  return resp;
+}
+
+//swap two lines, the data moves with the line
+static void cache_swap(int a,int b){
+  CACHE_LINE l;
+  unsigned char t;
+  int k;
+  l=lines[a];
+  lines[a]=lines[b];
+  lines[b]=l;
+  for(k=0;k<512;k++){
+    t=cache_dat[a][k];
+    cache_dat[a][k]=cache_dat[b][k];
+    cache_dat[b][k]=t;
+  }
+}
+
+//sort key that puts dirty lines first in address order
+static unsigned long cache_key(int i){
+  return (lines[i].valid && lines[i].dirty)?lines[i].addr:0xFFFFFFFF;
+}
+
+//find a free line or evict the least recently used line
+static int cache_victim(int *line){
+  int i,v=0;
+  int resp;
+  for(i=0;i<SD_CACHE_LINES;i++){
+    if(!lines[i].valid){
+      *line=i;
+      return MMC_SUCCESS;
+    }
+    if(lines[i].used<lines[v].used){
+      v=i;
+    }
+  }
+  stats.evictions++;
+  //dirty data must be written before the line can be reused
+  if((resp=cache_writeback(v))!=MMC_SUCCESS){
+    return resp;
+  }
+  lines[v].valid=0;
+  *line=v;
+  return MMC_SUCCESS;
+}
+
+//read a block through the cache
+int cache_readBlock(unsigned long addr,unsigned char *buf){
+  int i,resp;
+  if(!enabled){
+    return SD_read(addr,1,buf,SD_PRI_HIGH);
+  }
+  ctl_mutex_lock(&cache_mutex,CTL_TIMEOUT_NONE,0);
+  if((i=cache_find(addr))>=0){
+    stats.hits++;
+  }else{
+    stats.misses++;
+    if((resp=cache_victim(&i))!=MMC_SUCCESS){
+      ctl_mutex_unlock(&cache_mutex);
+      return resp;
+    }
+    if((resp=SD_read(addr,1,cache_dat[i],SD_PRI_HIGH))!=MMC_SUCCESS){
+      ctl_mutex_unlock(&cache_mutex);
+      return resp;
+    }
+    lines[i].addr=addr;
+    lines[i].valid=1;
+    lines[i].dirty=0;
+  }
+  lines[i].used=++use_count;
+  memcpy(buf,cache_dat[i],512);
+  ctl_mutex_unlock(&cache_mutex);
+  return MMC_SUCCESS;
+}
+
+//write a block through the cache
+int cache_writeBlock(unsigned long addr,const unsigned char *buf){
+  int i,resp;
+  if(!enabled){
+    return SD_write(addr,1,buf,SD_PRI_HIGH);
+  }
+  ctl_mutex_lock(&cache_mutex,CTL_TIMEOUT_NONE,0);
+  if((i=cache_find(addr))>=0){
+    stats.hits++;
+  }else{
+    //whole block is written so there is no need to read it first
+    stats.misses++;
+    if((resp=cache_victim(&i))!=MMC_SUCCESS){
+      ctl_mutex_unlock(&cache_mutex);
+      return resp;
+    }
+    lines[i].addr=addr;
+    lines[i].valid=1;
+  }
+  memcpy(cache_dat[i],buf,512);
+  lines[i].dirty=1;
+  lines[i].used=++use_count;
+  ctl_mutex_unlock(&cache_mutex);
+  return MMC_SUCCESS;
+}
+
+//write all dirty lines to the card
+//lines for consecutive blocks are sent as one multi block write
+int cache_flush(void){
+  WR_STREAM ws;
+  int i,j,k,resp,ret=MMC_SUCCESS;
+  ctl_mutex_lock(&cache_mutex,CTL_TIMEOUT_NONE,0);
+  //sort dirty lines by address so runs of blocks are next to each other in memory
+  for(i=0;i<SD_CACHE_LINES;i++){
+    for(j=i+1;j<SD_CACHE_LINES;j++){
+      if(cache_key(j)<cache_key(i)){
+        cache_swap(i,j);
+      }
+    }
+  }
+  for(i=0;i<SD_CACHE_LINES && cache_key(i)!=0xFFFFFFFF;i=j){
+    //each run is staged in place so no data is copied
+    wr_stream_init(&ws,cache_dat[i],SD_CACHE_LINES-i,SD_PRI_HIGH,WR_PRE_ERASE);
+    for(j=i;j<SD_CACHE_LINES && cache_key(j)!=0xFFFFFFFF && (j==i || lines[j].addr==lines[j-1].addr+1);j++){
+      wr_stream_block(&ws,lines[j].addr,&resp);
+    }
+    //keep going on errors so as much data as possible is written
+    if((resp=wr_stream_flush(&ws))!=MMC_SUCCESS){
+      ret=resp;
+      continue;
+    }
+    for(k=i;k<j;k++){
+      lines[k].dirty=0;
+      stats.writebacks++;
+    }
+  }
+  ctl_mutex_unlock(&cache_mutex);
+  return ret;
+}
+
+//change len bytes at offset off of block addr through the cache
+//with the cache disabled the block is read, changed and written right away
+int cache_update(unsigned long addr,unsigned short off,const void *dat,unsigned short len){
+  int i,resp;
+  ctl_mutex_lock(&cache_mutex,CTL_TIMEOUT_NONE,0);
+  if(!enabled){
+    //lines are not in use so borrow one for the block
+    if((resp=SD_read(addr,1,cache_dat[0],SD_PRI_HIGH))==MMC_SUCCESS){
+      memcpy(cache_dat[0]+off,dat,len);
+      resp=SD_write(addr,1,cache_dat[0],SD_PRI_HIGH);
+    }
+    ctl_mutex_unlock(&cache_mutex);
+    return resp;
+  }
+  if((i=cache_find(addr))>=0){
+    stats.hits++;
+  }else{
+    stats.misses++;
+    if((resp=cache_victim(&i))!=MMC_SUCCESS || (resp=SD_read(addr,1,cache_dat[i],SD_PRI_HIGH))!=MMC_SUCCESS){
+      ctl_mutex_unlock(&cache_mutex);
+      return resp;
+    }
+    lines[i].addr=addr;
+    lines[i].valid=1;
+  }
+  memcpy(cache_dat[i]+off,dat,len);
+  lines[i].dirty=1;
+  lines[i].used=++use_count;
+  ctl_mutex_unlock(&cache_mutex);
+  return MMC_SUCCESS;
+}
+
+//drop lines from start to end without writing them back
+void cache_invalidate(unsigned long start,unsigned long end){
+  int i;
+  ctl_mutex_lock(&cache_mutex,CTL_TIMEOUT_NONE,0);
+  for(i=0;i<SD_CACHE_LINES;i++){
+    if(lines[i].addr>=start && lines[i].addr<=end){
+      lines[i].valid=0;
+      lines[i].dirty=0;
+    }
+  }
+  ctl_mutex_unlock(&cache_mutex);
+}
+
+//flush and then drop all lines
+int cache_sync(void){
+  int resp;
+  ctl_mutex_lock(&cache_mutex,CTL_TIMEOUT_NONE,0);
+  //dirty lines that could not be written are kept so the data is not lost
+  if((resp=cache_flush())==MMC_SUCCESS){
+    cache_invalidate(0,0xFFFFFFFF);
+  }
+  ctl_mutex_unlock(&cache_mutex);
+  return resp;
+}
+
+//enable or disable the cache
+int cache_enable(int en){
+  int resp=MMC_SUCCESS;
+  if(!en && enabled){
+    //write out dirty data and forget everything, stay enabled if that fails
+    if((resp=cache_sync())!=MMC_SUCCESS){
+      return resp;
+    }
+  }
+  enabled=en;
+  return resp;
+}
+
+//return nonzero if the cache is enabled
+int cache_is_enabled(void){
+  return enabled;
+}
+
+//get cache statistics
+void cache_get_stats(SD_CACHE_STATS *s){
+  *s=stats;
+}
+
+//clear cache statistics
+void cache_clear_stats(void){
+  memset(&stats,0,sizeof(stats));
+}
@@ -0,0 +1,55 @@
+#ifndef __SDCACHE_H
+#define __SDCACHE_H
+
+//number of sectors held in the cache
+#ifndef SD_CACHE_LINES
+  #define SD_CACHE_LINES    2
+#endif
+
+//cache statistics
+typedef struct{
+  unsigned long hits;
+  unsigned long misses;
+  unsigned long evictions;
+  unsigned long writebacks;
+}SD_CACHE_STATS;
+
+//initialize the cache, must be called before tasks are started
+void cache_init(void);
+
+//read a block through the cache
+int cache_readBlock(unsigned long addr,unsigned char *buf);
+
+//write a block through the cache, data is written to the card
+//when the line is evicted or flushed
+int cache_writeBlock(unsigned long addr,const unsigned char *buf);
+
+//write all dirty lines to the card, lines for consecutive blocks
+//are merged into one multi block write
+int cache_flush(void);
+
+//change len bytes at offset off of block addr, the block is read if it is not in the cache
+int cache_update(unsigned long addr,unsigned short off,const void *dat,unsigned short len);
+
+//drop lines from start to end without writing them back
+//used when the card is written or erased without the cache
+void cache_invalidate(unsigned long start,unsigned long end);
+
+//flush and then drop all lines, lines are kept if the flush fails
+//used before code outside this program reads or writes the card
+int cache_sync(void);
+
+//enable or disable the cache, the cache is flushed when disabled
+//and stays enabled if the flush fails
+int cache_enable(int en);
+
+//return nonzero if the cache is enabled
+int cache_is_enabled(void);
+
+//get cache statistics
+void cache_get_stats(SD_CACHE_STATS *s);
+
+//clear cache statistics
+void cache_clear_stats(void);
+
+#endif
@@ -0,0 +1,162 @@
+#include <string.h>
+#include <ctl_api.h>
+#include <SDlib.h>
+#include "timerA.h"
+#include "SDstat.h"
+#include "cardinfo.h"
+
+static IO_STATS io_stats[IO_NUM_OPS];
+
+//only one task can talk to the card at a time
+static CTL_MUTEX_t card_mutex;
+
+static const char *const io_names[IO_NUM_OPS]={"read","mread","write","mwrite","erase","reg","init"};
+
+//setup card lock and clear statistics
+void io_init(void){
+  ctl_mutex_init(&card_mutex);
+  io_clear_stats();
+}
+
+//lock the card for a sequence of calls
+void io_card_lock(void){
+  ctl_mutex_lock(&card_mutex,CTL_TIMEOUT_NONE,0);
+}
+
+void io_card_unlock(void){
+  ctl_mutex_unlock(&card_mutex);
+}
+
+//return name of an operation
+const char *io_op_name(int op){
+  if(op<0 || op>=IO_NUM_OPS){
+    return "unknown";
+  }
+  return io_names[op];
+}
+
+//record an operation, start is the timestamp when it started
+static int io_record(int op,unsigned long start,unsigned long blocks,int resp){
+  unsigned long t=TA_elapsed(start),limit=0;
+  int en;
+  //longest time allowed for the card profile
+  if(op==IO_READ || op==IO_READ_MULTI){
+    limit=card_profile.read_timeout*blocks;
+  }else if(op==IO_WRITE || op==IO_WRITE_MULTI){
+    limit=card_profile.write_timeout*blocks;
+  }
+  if(limit){
+    limit=TA_ticks_to_us(t)>limit;
+  }
+  //calls can come from more then one task
+  en=ctl_global_interrupts_set(0);
+  io_stats[op].blocks+=blocks;
+  if(resp!=MMC_SUCCESS){
+    io_stats[op].errors++;
+  }
+  io_stats[op].late+=limit;
+  lat_add(&io_stats[op].lat,t);
+  ctl_global_interrupts_set(en);
+  return resp;
+}
+
+//get statistics for an operation
+void io_get_stats(int op,IO_STATS *s){
+  int en;
+  en=ctl_global_interrupts_set(0);
+  *s=io_stats[op];
+  ctl_global_interrupts_set(en);
+}
+
+//clear all statistics
+void io_clear_stats(void){
+  int i,en;
+  en=ctl_global_interrupts_set(0);
+  for(i=0;i<IO_NUM_OPS;i++){
+    io_stats[i].blocks=0;
+    io_stats[i].errors=0;
+    io_stats[i].late=0;
+    lat_init(&io_stats[i].lat);
+  }
+  ctl_global_interrupts_set(en);
+}
+
+int io_mmcInit_card(void){
+  unsigned long t;
+  int resp;
+  io_card_lock();
+  t=TA_time();
+  resp=io_record(IO_INIT,t,0,mmcInit_card());
+  io_card_unlock();
+  return resp;
+}
+
+int io_mmcReInit_card(void){
+  unsigned long t;
+  int resp;
+  io_card_lock();
+  t=TA_time();
+  resp=io_record(IO_INIT,t,0,mmcReInit_card());
+  io_card_unlock();
+  return resp;
+}
+
+int io_mmcReadBlock(unsigned long addr,unsigned char *buf){
+  unsigned long t;
+  int resp;
+  io_card_lock();
+  t=TA_time();
+  resp=io_record(IO_READ,t,1,mmcReadBlock(addr,buf));
+  io_card_unlock();
+  return resp;
+}
+
+int io_mmcReadBlocks(unsigned long addr,unsigned short count,unsigned char *buf){
+  unsigned long t;
+  int resp;
+  io_card_lock();
+  t=TA_time();
+  resp=io_record(IO_READ_MULTI,t,count,mmcReadBlocks(addr,count,buf));
+  io_card_unlock();
+  return resp;
+}
+
+int io_mmcWriteBlock(unsigned long addr,const unsigned char *buf){
+  unsigned long t;
+  int resp;
+  io_card_lock();
+  t=TA_time();
+  resp=io_record(IO_WRITE,t,1,mmcWriteBlock(addr,buf));
+  io_card_unlock();
+  return resp;
+}
+
+int io_mmcWriteMultiBlock(unsigned long addr,const unsigned char *buf,unsigned short count){
+  unsigned long t;
+  int resp;
+  io_card_lock();
+  t=TA_time();
+  resp=io_record(IO_WRITE_MULTI,t,count,mmcWriteMultiBlock(addr,buf,count));
+  io_card_unlock();
+  return resp;
+}
+
+int io_mmcErase(unsigned long start,unsigned long end){
+  unsigned long t;
+  int resp;
+  io_card_lock();
+  t=TA_time();
+  resp=io_record(IO_ERASE,t,end-start+1,mmcErase(start,end));
+  io_card_unlock();
+  return resp;
+}
+
+int io_mmcReadReg(unsigned char reg,unsigned char *buf){
+  unsigned long t;
+  int resp;
+  io_card_lock();
+  t=TA_time();
+  resp=io_record(IO_REG,t,0,mmcReadReg(reg,buf));
+  io_card_unlock();
+  return resp;
+}
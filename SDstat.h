@@ -0,0 +1,47 @@
+#ifndef __SDSTAT_H
+#define __SDSTAT_H
+
+#include "latency.h"
+
+//operations that are tracked
+enum{IO_READ=0,IO_READ_MULTI,IO_WRITE,IO_WRITE_MULTI,IO_ERASE,IO_REG,IO_INIT,IO_NUM_OPS};
+
+//statistics for one operation, 96 bytes with 17 latency buckets
+//so the table for all IO_NUM_OPS operations takes 672 bytes of RAM
+typedef struct{
+  unsigned long blocks;
+  unsigned long errors;
+  //operations that took longer then the card timeout
+  unsigned long late;
+  //latency in timer A ticks, also holds the number of calls
+  LAT_STATS lat;
+}IO_STATS;
+
+//setup card lock and clear statistics
+void io_init(void);
+
+//lock the card for a sequence of calls, the io_mmc* calls lock it for each call
+//the lock is recursive so the io_mmc* calls can be used while it is held
+void io_card_lock(void);
+void io_card_unlock(void);
+
+//return name of an operation
+const char *io_op_name(int op);
+
+//get statistics for an operation
+void io_get_stats(int op,IO_STATS *s);
+
+//clear all statistics
+void io_clear_stats(void);
+
+//SDlib calls with statistics, one task at a time has the card
+int io_mmcInit_card(void);
+int io_mmcReInit_card(void);
+int io_mmcReadBlock(unsigned long addr,unsigned char *buf);
+int io_mmcReadBlocks(unsigned long addr,unsigned short count,unsigned char *buf);
+int io_mmcWriteBlock(unsigned long addr,const unsigned char *buf);
+int io_mmcWriteMultiBlock(unsigned long addr,const unsigned char *buf,unsigned short count);
+int io_mmcErase(unsigned long start,unsigned long end);
+int io_mmcReadReg(unsigned char reg,unsigned char *buf);
+
+#endif
@@ -0,0 +1,246 @@
+#include <string.h>
+#include <SDlib.h>
+#include "SDstream.h"
+#include "SDstat.h"
+#include "SDtask.h"
+#include "cardinfo.h"
+
+static WR_STREAM_STATS wr_stats;
+static RD_STREAM_STATS rd_stats;
+
+//number of blocks to read ahead, 0 follows the card profile
+unsigned short rd_stream_window=0;
+
+//number of blocks that will be read ahead
+unsigned short rd_stream_get_window(void){
+  return rd_stream_window?rd_stream_window:card_profile.batch;
+}
+
+//setup a write stream using blocks*512 bytes of buf for staging
+void wr_stream_init(WR_STREAM *w,unsigned char *buf,unsigned short blocks,unsigned char pri,unsigned short flags){
+  w->buf=buf;
+  w->size=blocks;
+  w->count=0;
+  w->start=0;
+  w->pri=pri;
+  w->flags=flags;
+}
+
+//write all staged blocks to the card
+int wr_stream_flush(WR_STREAM *w){
+  int resp;
+  if(w->count==0){
+    return MMC_SUCCESS;
+  }
+  if(w->flags&WR_PRE_ERASE && w->count>1){
+    //send ACMD23 here once SDlib supports it
+    wr_stats.pre_erase++;
+  }
+  resp=SD_write(w->start,w->count,w->buf,w->pri);
+  if(resp==MMC_SUCCESS){
+    wr_stats.transfers++;
+    wr_stats.merged+=w->count-1;
+  }
+  //staged data is dropped on error so the caller can restart
+  w->count=0;
+  return resp;
+}
+
+//count a finished transfer from wr_stream_gen
+static void wr_gen_done(unsigned short n){
+  wr_stats.blocks+=n;
+  wr_stats.transfers++;
+  wr_stats.merged+=n-1;
+}
+
+//write count blocks starting at addr with data from gen
+int wr_stream_gen(unsigned long addr,unsigned long count,WR_GEN gen,void *ctx,unsigned char *buf,unsigned short blocks,int pipe){
+  SD_REQ req[2];
+  CTL_EVENT_SET_t evt;
+  unsigned short n,k;
+  int b,busy[2]={0,0},resp=MMC_SUCCESS;
+  if(!pipe || blocks<2){
+    for(;count;addr+=n,count-=n){
+      n=(count<blocks)?count:blocks;
+      for(k=0;k<n;k++){
+        if((resp=gen(ctx,addr+k,buf+k*512))!=MMC_SUCCESS){
+          return resp;
+        }
+      }
+      if(n==1){
+        resp=io_mmcWriteBlock(addr,buf);
+      }else{
+        resp=io_mmcWriteMultiBlock(addr,buf,n);
+      }
+      if(resp!=MMC_SUCCESS){
+        return resp;
+      }
+      wr_gen_done(n);
+    }
+    return MMC_SUCCESS;
+  }
+  //each half of the buffer has its own request
+  blocks/=2;
+  ctl_events_init(&evt,0);
+  for(b=0;b<2;b++){
+    req[b].type=SD_REQ_WRITE;
+    req[b].pri=SD_PRI_LOW;
+    req[b].buf=buf+b*blocks*512;
+    req[b].done=&evt;
+    req[b].done_evt=1<<b;
+  }
+  for(b=0;count;b^=1,addr+=n,count-=n){
+    //the last write from this half must finish before it is refilled
+    if(busy[b]){
+      ctl_events_wait(CTL_EVENT_WAIT_ANY_EVENTS_WITH_AUTO_CLEAR,&evt,1<<b,CTL_TIMEOUT_NONE,0);
+      busy[b]=0;
+      if((resp=req[b].result)!=MMC_SUCCESS){
+        break;
+      }
+      wr_gen_done(req[b].count);
+    }
+    n=(count<blocks)?count:blocks;
+    for(k=0;k<n;k++){
+      if((resp=gen(ctx,addr+k,req[b].buf+k*512))!=MMC_SUCCESS){
+        break;
+      }
+    }
+    if(resp!=MMC_SUCCESS){
+      break;
+    }
+    req[b].addr=addr;
+    req[b].count=n;
+    while(SD_submit(&req[b])){
+      //queue is full, give the SD task a tick
+      ctl_timeout_wait(ctl_get_current_time()+1);
+    }
+    busy[b]=1;
+  }
+  //requests must finish before they go out of scope
+  for(b=0;b<2;b++){
+    if(busy[b]){
+      ctl_events_wait(CTL_EVENT_WAIT_ANY_EVENTS_WITH_AUTO_CLEAR,&evt,1<<b,CTL_TIMEOUT_NONE,0);
+      if(req[b].result!=MMC_SUCCESS){
+        if(resp==MMC_SUCCESS){
+          resp=req[b].result;
+        }
+      }else{
+        wr_gen_done(req[b].count);
+      }
+    }
+  }
+  return resp;
+}
+
+//get staging space for block addr
+unsigned char *wr_stream_block(WR_STREAM *w,unsigned long addr,int *resp){
+  //flush if the block does not continue the run or there is no room
+  if(w->count!=0 && (addr!=w->start+w->count || w->count>=w->size)){
+    if((*resp=wr_stream_flush(w))!=MMC_SUCCESS){
+      return NULL;
+    }
+  }
+  if(w->count==0){
+    w->start=addr;
+  }
+  wr_stats.blocks++;
+  *resp=MMC_SUCCESS;
+  return w->buf+512*(w->count++);
+}
+
+//get write coalescing statistics
+void wr_stream_get_stats(WR_STREAM_STATS *s){
+  *s=wr_stats;
+}
+
+//clear write coalescing statistics
+void wr_stream_clear_stats(void){
+  memset(&wr_stats,0,sizeof(wr_stats));
+}
+
+//setup a read stream using blocks*512 bytes of buf for prefetching
+void rd_stream_init(RD_STREAM *r,unsigned char *buf,unsigned short blocks,unsigned long last){
+  r->buf=buf;
+  r->last=last;
+  r->size=blocks;
+  r->count=0;
+  r->used=0;
+  r->start=0;
+  //first read is treated as the start of a sequential run
+  r->next=0xFFFFFFFF;
+}
+
+//drop buffered blocks and count the ones that were not used
+static void rd_stream_drop(RD_STREAM *r){
+  if(r->count>r->used){
+    rd_stats.wasted+=r->count-r->used;
+  }
+  r->count=0;
+  r->used=0;
+}
+
+//get a pointer to the data for block addr
+unsigned char *rd_stream_block(RD_STREAM *r,unsigned long addr,int *resp){
+  unsigned short n,idx;
+  rd_stats.blocks++;
+  *resp=MMC_SUCCESS;
+  //check for buffered block
+  if(r->count!=0 && addr>=r->start && addr<r->start+r->count){
+    idx=addr-r->start;
+    //first use of each block is counted for wasted reads
+    if(idx>=r->used){
+      r->used=idx+1;
+    }
+    //block zero was read on demand
+    if(idx!=0){
+      rd_stats.hits++;
+    }
+    r->next=addr+1;
+    return r->buf+512*idx;
+  }
+  rd_stream_drop(r);
+  //read ahead only when access is sequential
+  n=1;
+  if(addr==r->next || r->next==0xFFFFFFFF){
+    n=rd_stream_get_window();
+    if(n>r->size){
+      n=r->size;
+    }
+    //don't read past the end of the callers range
+    if(addr<=r->last && r->last-addr<n){
+      n=r->last-addr+1;
+    }
+    if(n==0){
+      n=1;
+    }
+  }
+  if(n==1){
+    *resp=io_mmcReadBlock(addr,r->buf);
+  }else{
+    *resp=io_mmcReadBlocks(addr,n,r->buf);
+  }
+  if(*resp!=MMC_SUCCESS){
+    return NULL;
+  }
+  rd_stats.prefetched+=n-1;
+  r->start=addr;
+  r->count=n;
+  r->used=1;
+  r->next=addr+1;
+  return r->buf;
+}
+
+//finish with a read stream
+void rd_stream_close(RD_STREAM *r){
+  rd_stream_drop(r);
+}
+
+//get read ahead statistics
+void rd_stream_get_stats(RD_STREAM_STATS *s){
+  *s=rd_stats;
+}
+
+//clear read ahead statistics
+void rd_stream_clear_stats(void){
+  memset(&rd_stats,0,sizeof(rd_stats));
+}
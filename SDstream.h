@@ -0,0 +1,121 @@
+#ifndef __SDSTREAM_H
+#define __SDSTREAM_H
+
+//write stream flags
+//WR_PRE_ERASE asks for the number of blocks to be sent with ACMD23 before a multi block write
+//SDlib has no way to send ACMD23 so the flag is only counted until it does
+enum{WR_PRE_ERASE=1<<0};
+
+//write stream, collects writes to consecutive blocks and sends them
+//to the card as one multi block write through the SD task
+typedef struct{
+  //staging buffer supplied by the caller
+  unsigned char *buf;
+  //number of blocks that fit in the buffer
+  unsigned short size;
+  //number of blocks staged
+  unsigned short count;
+  //address of the first staged block
+  unsigned long start;
+  //SD task priority for the writes
+  unsigned char pri;
+  unsigned short flags;
+}WR_STREAM;
+
+//write coalescing statistics
+typedef struct{
+  //blocks written through streams
+  unsigned long blocks;
+  //transfers sent to the card
+  unsigned long transfers;
+  //single block writes that were merged into multi block writes
+  unsigned long merged;
+  //multi block writes that asked for a pre-erase count that could not be sent
+  unsigned long pre_erase;
+}WR_STREAM_STATS;
+
+//read stream, detects sequential reads and fetches the following
+//blocks with one multi block read
+typedef struct{
+  //prefetch buffer supplied by the caller
+  unsigned char *buf;
+  //number of blocks that fit in the buffer
+  unsigned short size;
+  //blocks in the buffer and how many of them have been used
+  unsigned short count,used;
+  //address of the first buffered block
+  unsigned long start;
+  //address expected if access is sequential
+  unsigned long next;
+  //last block the caller will read, prefetch stops here
+  unsigned long last;
+}RD_STREAM;
+
+//read ahead statistics
+typedef struct{
+  //blocks read through streams
+  unsigned long blocks;
+  //blocks served from the prefetch buffer
+  unsigned long hits;
+  //blocks read ahead of use
+  unsigned long prefetched;
+  //prefetched blocks that were never used
+  unsigned long wasted;
+}RD_STREAM_STATS;
+
+//number of blocks to read ahead, 1 disables read ahead
+//0 uses the batch size from the card profile
+extern unsigned short rd_stream_window;
+
+//number of blocks that will be read ahead
+unsigned short rd_stream_get_window(void);
+
+//setup a write stream using blocks*512 bytes of buf for staging
+//writes are sent to the SD task with priority pri, flags are from the write stream flags
+void wr_stream_init(WR_STREAM *w,unsigned char *buf,unsigned short blocks,unsigned char pri,unsigned short flags);
+
+//get staging space for block addr, staged blocks are written first
+//if addr does not follow them or the buffer is full
+//returns NULL and sets *resp on write error
+//data already in place in the buffer is not touched so callers that keep
+//blocks in order in buf can stage them without copying
+unsigned char *wr_stream_block(WR_STREAM *w,unsigned long addr,int *resp);
+
+//write all staged blocks to the card
+int wr_stream_flush(WR_STREAM *w);
+
+//generator for wr_stream_gen, fills the block for addr
+//returns MMC_SUCCESS or an error to stop the write
+typedef int (*WR_GEN)(void *ctx,unsigned long addr,unsigned char *buf);
+
+//write count blocks starting at addr with data from gen using blocks*512
+//bytes of buf, each buffer full is sent as one multi block write
+//with pipe the buffer is split in two and one half is written by the SD
+//task while the other half is generated
+int wr_stream_gen(unsigned long addr,unsigned long count,WR_GEN gen,void *ctx,unsigned char *buf,unsigned short blocks,int pipe);
+
+//get write coalescing statistics
+void wr_stream_get_stats(WR_STREAM_STATS *s);
+
+//clear write coalescing statistics
+void wr_stream_clear_stats(void);
+
+//setup a read stream using blocks*512 bytes of buf for prefetching
+//blocks past last are never read ahead
+void rd_stream_init(RD_STREAM *r,unsigned char *buf,unsigned short blocks,unsigned long last);
+
+//get a pointer to the data for block addr
+//the pointer is valid until the next call
+//returns NULL and sets *resp on read error
+unsigned char *rd_stream_block(RD_STREAM *r,unsigned long addr,int *resp);
+
+//finish with a read stream, counts unused prefetched blocks
+void rd_stream_close(RD_STREAM *r);
+
+//get read ahead statistics
+void rd_stream_get_stats(RD_STREAM_STATS *s);
+
+//clear read ahead statistics
+void rd_stream_clear_stats(void);
+
+#endif
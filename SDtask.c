@@ -0,0 +1,169 @@
+#include <string.h>
+#include <ctl_api.h>
+#include <SDlib.h>
+#include "SDtask.h"
+#include "SDstat.h"
+#include "timerA.h"
+
+//events for queues not empty
+enum{SD_EV_HIGH=1<<SD_PRI_HIGH,SD_EV_LOW=1<<SD_PRI_LOW};
+
+//event bit for synchronous requests
+#define SD_EV_DONE    0x01
+
+static CTL_MESSAGE_QUEUE_t queues[SD_NUM_PRI];
+static void *queue_buf[SD_NUM_PRI][SD_QUEUE_LEN];
+static CTL_EVENT_SET_t SD_evt;
+static SD_QUEUE_STATS stats[SD_NUM_PRI];
+
+//setup queues, must be called before tasks are started
+void SDtask_init(void){
+  int i;
+  ctl_events_init(&SD_evt,0);
+  for(i=0;i<SD_NUM_PRI;i++){
+    ctl_message_queue_init(&queues[i],queue_buf[i],SD_QUEUE_LEN);
+    //set event bit when there are requests waiting
+    ctl_message_queue_setup_events(&queues[i],&SD_evt,1<<i,0);
+  }
+  memset(stats,0,sizeof(stats));
+}
+
+//carry out a request
+static int SD_service(SD_REQ *req){
+  switch(req->type){
+    case SD_REQ_READ:
+      if(req->count==1){
+        return io_mmcReadBlock(req->addr,req->buf);
+      }
+      return io_mmcReadBlocks(req->addr,req->count,req->buf);
+    case SD_REQ_WRITE:
+      if(req->count==1){
+        return io_mmcWriteBlock(req->addr,req->buf);
+      }
+      return io_mmcWriteMultiBlock(req->addr,req->buf,req->count);
+    case SD_REQ_ERASE:
+      return io_mmcErase(req->addr,req->end);
+    default:
+      return MMC_OTHER_ERROR;
+  }
+}
+
+//SD task, serves requests from the queues
+void sd_server(void *p) __toplevel{
+  SD_REQ *req;
+  void *msg;
+  unsigned long t,wait;
+  for(;;){
+    //wait for a request in either queue
+    ctl_events_wait(CTL_EVENT_WAIT_ANY_EVENTS,&SD_evt,SD_EV_HIGH|SD_EV_LOW,CTL_TIMEOUT_NONE,0);
+    //high priority requests are always taken first
+    if(!ctl_message_queue_receive_nb(&queues[SD_PRI_HIGH],&msg) && !ctl_message_queue_receive_nb(&queues[SD_PRI_LOW],&msg)){
+      continue;
+    }
+    req=msg;
+    t=TA_time();
+    wait=t-req->submitted;
+    stats[req->pri].wait_total+=wait;
+    if(wait>stats[req->pri].wait_max){
+      stats[req->pri].wait_max=wait;
+    }
+    req->result=SD_service(req);
+    stats[req->pri].service_total+=TA_elapsed(t);
+    //notify requester
+    if(req->done){
+      ctl_events_set_clear(req->done,req->done_evt,0);
+    }
+  }
+}
+
+//add a request to its queue
+static int SD_post(SD_REQ *req,int block){
+  unsigned short depth;
+  int en;
+  if(req->pri>=SD_NUM_PRI){
+    req->pri=SD_PRI_LOW;
+  }
+  req->submitted=TA_time();
+  //sample depth before posting, the SD task can take the request as soon as it is posted
+  depth=ctl_message_queue_num_used(&queues[req->pri])+1;
+  if(depth>SD_QUEUE_LEN){
+    //blocking post waits for a free slot
+    depth=SD_QUEUE_LEN;
+  }
+  if(block){
+    ctl_message_queue_post(&queues[req->pri],req,CTL_TIMEOUT_NONE,0);
+  }else if(!ctl_message_queue_post_nb(&queues[req->pri],req)){
+    en=ctl_global_interrupts_set(0);
+    stats[req->pri].rejected++;
+    ctl_global_interrupts_set(en);
+    return 1;
+  }
+  //update stats, other tasks can submit at the same time
+  en=ctl_global_interrupts_set(0);
+  stats[req->pri].requests++;
+  if(depth>stats[req->pri].max_depth){
+    stats[req->pri].max_depth=depth;
+  }
+  ctl_global_interrupts_set(en);
+  return 0;
+}
+
+//submit a request without waiting
+int SD_submit(SD_REQ *req){
+  return SD_post(req,0);
+}
+
+//submit a request and wait for it to finish
+int SD_request(SD_REQ *req){
+  CTL_EVENT_SET_t evt;
+  ctl_events_init(&evt,0);
+  req->done=&evt;
+  req->done_evt=SD_EV_DONE;
+  SD_post(req,1);
+  ctl_events_wait(CTL_EVENT_WAIT_ANY_EVENTS_WITH_AUTO_CLEAR,&evt,SD_EV_DONE,CTL_TIMEOUT_NONE,0);
+  return req->result;
+}
+
+int SD_read(unsigned long addr,unsigned short count,unsigned char *buf,unsigned char pri){
+  SD_REQ req;
+  req.type=SD_REQ_READ;
+  req.pri=pri;
+  req.addr=addr;
+  req.count=count;
+  req.buf=buf;
+  return SD_request(&req);
+}
+
+int SD_write(unsigned long addr,unsigned short count,const unsigned char *buf,unsigned char pri){
+  SD_REQ req;
+  req.type=SD_REQ_WRITE;
+  req.pri=pri;
+  req.addr=addr;
+  req.count=count;
+  req.buf=(unsigned char*)buf;
+  return SD_request(&req);
+}
+
+int SD_erase(unsigned long start,unsigned long end,unsigned char pri){
+  SD_REQ req;
+  req.type=SD_REQ_ERASE;
+  req.pri=pri;
+  req.addr=start;
+  req.end=end;
+  return SD_request(&req);
+}
+
+//get queue statistics
+void SD_get_queue_stats(SD_QUEUE_STATS s[SD_NUM_PRI]){
+  memcpy(s,stats,sizeof(stats));
+}
+
+//return number of requests waiting in a queue
+unsigned short SD_queue_depth(unsigned char pri){
+  return ctl_message_queue_num_used(&queues[pri]);
+}
+
+//clear queue statistics
+void SD_clear_queue_stats(void){
+  memset(stats,0,sizeof(stats));
+}
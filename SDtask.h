@@ -0,0 +1,70 @@
+#ifndef __SDTASK_H
+#define __SDTASK_H
+
+#include <ctl_api.h>
+
+//number of requests that can wait in each queue
+#define SD_QUEUE_LEN      8
+
+//request types
+enum{SD_REQ_READ=0,SD_REQ_WRITE,SD_REQ_ERASE};
+
+//request priorities, high priority requests are always served first
+enum{SD_PRI_HIGH=0,SD_PRI_LOW,SD_NUM_PRI};
+
+//request for the SD task
+//the request must not be changed or go out of scope until it completes
+typedef struct{
+  unsigned char type,pri;
+  //number of blocks for reads and writes
+  unsigned short count;
+  //first block and last block for erase
+  unsigned long addr,end;
+  unsigned char *buf;
+  //event set and bits to set when the request completes
+  CTL_EVENT_SET_t *done;
+  CTL_EVENT_SET_t done_evt;
+  //result from SDlib
+  int result;
+  //timer A timestamp when the request was submitted
+  unsigned long submitted;
+}SD_REQ;
+
+//queue statistics for each priority, times are in timer A ticks
+typedef struct{
+  unsigned long requests;
+  unsigned long rejected;
+  unsigned short max_depth;
+  unsigned long wait_total;
+  unsigned long wait_max;
+  unsigned long service_total;
+}SD_QUEUE_STATS;
+
+//setup queues, must be called before tasks are started
+void SDtask_init(void);
+
+//SD task, serves requests from the queues
+void sd_server(void *p);
+
+//submit a request without waiting, request is completed by setting done_evt in done
+//returns zero on success or nonzero if the queue is full
+int SD_submit(SD_REQ *req);
+
+//submit a request and wait for it to finish, returns SDlib result
+int SD_request(SD_REQ *req);
+
+//read, write and erase through the SD task and wait for completion
+int SD_read(unsigned long addr,unsigned short count,unsigned char *buf,unsigned char pri);
+int SD_write(unsigned long addr,unsigned short count,const unsigned char *buf,unsigned char pri);
+int SD_erase(unsigned long start,unsigned long end,unsigned char pri);
+
+//get queue statistics
+void SD_get_queue_stats(SD_QUEUE_STATS s[SD_NUM_PRI]);
+
+//return number of requests waiting in a queue
+unsigned short SD_queue_depth(unsigned char pri);
+
+//clear queue statistics
+void SD_clear_queue_stats(void);
+
+#endif
@@ -0,0 +1,155 @@
+#include <stdio.h>
+#include <SDlib.h>
+#include "cardinfo.h"
+#include "SDstat.h"
+
+//settings used before the card registers are read
+CARD_PROFILE card_profile={0,CARD_BATCH_MAX,1,1,100000UL,250000UL};
+
+//mantissa for TAAC and TRAN_SPEED times 10
+static const unsigned char time_val[16]={0,10,12,13,15,20,25,30,35,40,45,50,55,60,70,80};
+
+//TAAC time units in ns
+static const unsigned long taac_unit[8]={1,10,100,1000,10000,100000,1000000,10000000};
+
+//TRAN_SPEED rate units in kbit/s
+static const unsigned long speed_unit[4]={100,1000,10000,100000};
+
+//extract width bits ending at bit msb from a 128 bit register
+//reg[0] holds bits 127 to 120
+static unsigned long reg_bits(const unsigned char *reg,unsigned short msb,unsigned short width){
+  unsigned long v=0;
+  unsigned short b;
+  for(b=msb;width;width--,b--){
+    v=(v<<1)|((reg[(127-b)/8]>>(b%8))&1);
+  }
+  return v;
+}
+
+//decode CSD register
+void csd_decode(const unsigned char *reg,CSD_INFO *csd){
+  unsigned char ts;
+  csd->version=reg_bits(reg,127,2)+1;
+  csd->taac=reg_bits(reg,119,8);
+  csd->nsac=reg_bits(reg,111,8);
+  csd->taac_ns=taac_unit[csd->taac&7]*time_val[(csd->taac>>3)&0x0F]/10;
+  ts=reg_bits(reg,103,8);
+  csd->tran_speed=(ts&4)?0:speed_unit[ts&3]*time_val[(ts>>3)&0x0F]/10;
+  csd->ccc=reg_bits(reg,95,12);
+  csd->read_bl_len=reg_bits(reg,83,4);
+  csd->erase_blk_en=reg_bits(reg,46,1);
+  csd->perm_wp=reg_bits(reg,13,1);
+  csd->tmp_wp=reg_bits(reg,12,1);
+  csd->r2w_factor=reg_bits(reg,28,3);
+  csd->write_bl_len=reg_bits(reg,25,4);
+  //sector size is in write blocks
+  csd->erase_sector=reg_bits(reg,45,7)+1;
+  if(csd->write_bl_len>9){
+    csd->erase_sector<<=csd->write_bl_len-9;
+  }
+  if(csd->version==1){
+    //capacity is (C_SIZE+1)*2^(C_SIZE_MULT+2) blocks of 2^READ_BL_LEN bytes
+    csd->capacity=(reg_bits(reg,73,12)+1)<<(reg_bits(reg,49,3)+2+csd->read_bl_len-10);
+  }else{
+    //capacity is (C_SIZE+1)*512KB
+    csd->capacity=(reg_bits(reg,69,22)+1)*512;
+  }
+}
+
+//decode CID register
+void cid_decode(const unsigned char *reg,CID_INFO *cid){
+  int i;
+  cid->mid=reg[0];
+  cid->oid[0]=reg[1];
+  cid->oid[1]=reg[2];
+  cid->oid[2]=0;
+  for(i=0;i<5;i++){
+    cid->pnm[i]=reg[3+i];
+  }
+  cid->pnm[5]=0;
+  cid->prv=reg[8];
+  cid->psn=reg_bits(reg,55,32);
+  cid->year=2000+reg_bits(reg,19,8);
+  cid->month=reg_bits(reg,11,4);
+}
+
+//print decoded CSD
+void csd_print(const CSD_INFO *csd){
+  printf("CSD version     : %u.0%s\r\n",csd->version,csd->version==1?" (standard capacity)":" (high capacity)");
+  printf("TAAC            : 0x%02X, %lu ns\r\n",csd->taac,csd->taac_ns);
+  printf("NSAC            : %u clocks\r\n",csd->nsac*100);
+  printf("TRAN_SPEED      : %lu kbit/s\r\n",csd->tran_speed);
+  printf("CCC             : 0x%03X\r\n",csd->ccc);
+  printf("READ_BL_LEN     : %u bytes\r\n",1<<csd->read_bl_len);
+  printf("WRITE_BL_LEN    : %u bytes\r\n",1<<csd->write_bl_len);
+  printf("R2W_FACTOR      : x%u\r\n",1<<csd->r2w_factor);
+  printf("ERASE_BLK_EN    : %u\r\n",csd->erase_blk_en);
+  printf("erase sector    : %u blocks\r\n",csd->erase_sector);
+  printf("write protect   : %s%s\r\n",csd->perm_wp?"permanent ":"",csd->tmp_wp?"temporary":(csd->perm_wp?"":"none"));
+  printf("capacity        : %lu KB\r\n",csd->capacity);
+}
+
+//print decoded CID
+void cid_print(const CID_INFO *cid){
+  printf("manufacturer    : 0x%02X\r\n",cid->mid);
+  printf("OEM             : %s\r\n",cid->oid);
+  printf("product         : %s rev %u.%u\r\n",cid->pnm,cid->prv>>4,cid->prv&0x0F);
+  printf("serial          : 0x%08lX\r\n",cid->psn);
+  printf("date            : %u/%u\r\n",cid->month,cid->year);
+}
+
+//read the CSD and update card_profile and the settings that depend on it
+int card_probe(void){
+  unsigned char reg[16];
+  CSD_INFO csd;
+  unsigned long access;
+  int resp;
+  if((resp=io_mmcReadReg(0x40|9,reg))!=MMC_SUCCESS){
+    return resp;
+  }
+  csd_decode(reg,&csd);
+  //erases that are not whole sectors take the rest of the sector with them
+  card_profile.erase_blk_en=csd.erase_blk_en;
+  card_profile.erase_unit=csd.erase_blk_en?1:csd.erase_sector;
+  //keep transfers inside one erase sector when it is smaller then the buffer
+  card_profile.batch=(csd.erase_sector<CARD_BATCH_MAX)?csd.erase_sector:CARD_BATCH_MAX;
+  if(csd.version==1){
+    //100 times the access time from TAAC and NSAC, the clock is taken as TRAN_SPEED
+    access=csd.taac_ns/1000;
+    if(csd.tran_speed){
+      access+=(csd.nsac*100UL*1000)/csd.tran_speed;
+    }
+    card_profile.read_timeout=access*100;
+    card_profile.write_timeout=(access*100)<<csd.r2w_factor;
+    //limits from the SD spec
+    if(card_profile.read_timeout>100000UL){
+      card_profile.read_timeout=100000UL;
+    }
+    if(card_profile.write_timeout>250000UL){
+      card_profile.write_timeout=250000UL;
+    }
+  }else{
+    //fixed timeouts for high capacity cards
+    card_profile.read_timeout=100000UL;
+    card_profile.write_timeout=250000UL;
+  }
+  card_profile.valid=1;
+  return MMC_SUCCESS;
+}
+
+//print the card profile
+void card_print_profile(void){
+  printf("profile         : %s\r\n",card_profile.valid?"from CSD":"defaults");
+  printf("batch           : %u blocks\r\n",card_profile.batch);
+  printf("erase unit      : %u blocks\r\n",card_profile.erase_unit);
+  printf("read timeout    : %lu us\r\n",card_profile.read_timeout);
+  printf("write timeout   : %lu us\r\n",card_profile.write_timeout);
+}
+
+//check that erasing blocks start to end will not take other blocks with it
+int card_erase_ok(unsigned long start,unsigned long end){
+  if(card_profile.erase_blk_en){
+    return 1;
+  }
+  return (start%card_profile.erase_unit)==0 && ((end+1)%card_profile.erase_unit)==0;
+}
@@ -0,0 +1,78 @@
+#ifndef __CARDINFO_H
+#define __CARDINFO_H
+
+//most blocks that fit in the 2048 byte bus buffer
+#define CARD_BATCH_MAX    4
+
+//decoded CSD register
+typedef struct{
+  //CSD structure version, 1 for standard capacity and 2 for high capacity
+  unsigned char version;
+  //raw access time fields
+  unsigned char taac,nsac;
+  //access time in ns from TAAC
+  unsigned long taac_ns;
+  //max transfer rate in kbit/s
+  unsigned long tran_speed;
+  //card command classes
+  unsigned short ccc;
+  //block lengths as log2 of bytes
+  unsigned char read_bl_len,write_bl_len;
+  //write time as log2 multiple of read time
+  unsigned char r2w_factor;
+  //single block erase is allowed
+  unsigned char erase_blk_en;
+  //erase sector size in 512 byte blocks
+  unsigned short erase_sector;
+  //write protect flags
+  unsigned char perm_wp,tmp_wp;
+  //capacity in KB
+  unsigned long capacity;
+}CSD_INFO;
+
+//decoded CID register
+typedef struct{
+  unsigned char mid;
+  char oid[3];
+  char pnm[6];
+  unsigned char prv;
+  unsigned long psn;
+  unsigned short year;
+  unsigned char month;
+}CID_INFO;
+
+//I/O settings chosen from the card registers
+typedef struct{
+  //nonzero once the CSD has been read
+  unsigned char valid;
+  //blocks per multi block transfer
+  unsigned short batch;
+  //erases must cover whole units of this many blocks unless erase_blk_en is set
+  unsigned short erase_unit;
+  unsigned char erase_blk_en;
+  //longest time the card may take for each block in us
+  unsigned long read_timeout,write_timeout;
+}CARD_PROFILE;
+
+//profile for the current card, defaults are used until card_probe succeeds
+extern CARD_PROFILE card_profile;
+
+//decode raw registers as read by mmcReadReg
+void csd_decode(const unsigned char *reg,CSD_INFO *csd);
+void cid_decode(const unsigned char *reg,CID_INFO *cid);
+
+//print decoded registers
+void csd_print(const CSD_INFO *csd);
+void cid_print(const CID_INFO *cid);
+
+//read the CSD and update card_profile and the settings that depend on it
+int card_probe(void);
+
+//print the card profile
+void card_print_profile(void);
+
+//check that erasing blocks start to end will not take other blocks with it
+//always true for cards with ERASE_BLK_EN, otherwise the range must be whole erase sectors
+int card_erase_ok(unsigned long start,unsigned long end);
+
+#endif
@@ -10,11 +10,22 @@
 #include <ARCbus.h>
 #include <Error.h>
 #include "SDtst_errors.h"
-
-
-//define printf formats
-#define HEXOUT_STR    "%02X "
-#define ASCIIOUT_STR  "%c"
+#include "timerA.h"
+#include "latency.h"
+#include "pattern.h"
+#include "hexdump.h"
+#include "crc16.h"
+#include "xfer.h"
+#include "SDcache.h"
+#include "SDstream.h"
+#include "SDtask.h"
+#include "SDstat.h"
+#include "profile.h"
+#include "stackmon.h"
+#include "cardinfo.h"
+#include "spiclk.h"
+#include "errlog.h"
+#include "jobs.h"
 
 
 //helper function to parse I2C address
@@ -97,6 +108,9 @@ int restCmd(char **argv,unsigned short argc){
   }
   //reset if no arguments given or to reset all boards
   if(argc==0 || all){
+    //write out staged errors and cached blocks, they are lost on reset
+    errlog_sync();
+    cache_sync();
     //Close async connection
     async_close();
     //write to WDTCTL without password causes PUC
@@ -289,7 +303,7 @@ int mmc_write(char **argv, unsigned short argc){
   //Terminate string
   *(ptr-1)=0;
   //write data
-  resp=mmcWriteBlock(0,buffer);
+  resp=cache_writeBlock(0,buffer);
   //check if write was successful
   if(resp==MMC_SUCCESS){
     printf("data written to memeory\r\n");
@@ -314,7 +328,7 @@ int mmc_read(char **argv, unsigned short argc){
   //init buffer
   memset(buffer,0,513);
   //read from SD card
-  resp=mmcReadBlock(0,(unsigned char*)buffer);
+  resp=cache_readBlock(0,(unsigned char*)buffer);
   //check for error
   if(resp!=MMC_SUCCESS){
     //print error from SD card
@@ -347,16 +361,24 @@ int mmc_read(char **argv, unsigned short argc){
 
 int mmc_dump(char **argv, unsigned short argc){
   int resp; 
-  char *buffer=NULL;
+  char *buffer=NULL,*end;
   unsigned long sector=0;
+  unsigned short flags=0;
   int i;
-  //check if sector given
-  if(argc!=0){
-    //read sector
-    if(1!=sscanf(argv[1],"%ul",&sector)){
-      //print error
-      printf("Error parsing sector \"%s\"\r\n",argv[1]);
-      return -1;
+  //check arguments
+  for(i=1;i<=argc;i++){
+    if(!strcmp(argv[i],"ascii")){
+      flags|=HEX_ASCII;
+    }else if(!strcmp(argv[i],"offset")){
+      flags|=HEX_OFFSET;
+    }else{
+      //read sector
+      sector=strtoul(argv[i],&end,0);
+      if(end==argv[i] || *end!=0){
+        //print error
+        printf("Error parsing sector \"%s\"\r\n",argv[i]);
+        return -1;
+      }
     }
   }
   //get buffer, set a timeout of 2 secconds
@@ -367,15 +389,12 @@ int mmc_dump(char **argv, unsigned short argc){
     return -1;
   }
   //read from SD card
-  resp=mmcReadBlock(sector,(unsigned char*)buffer);
+  resp=cache_readBlock(sector,(unsigned char*)buffer);
   //print response from SD card
   printf("%s\r\n",SD_error_str(resp));
-  //print out buffer
-  for(i=0;i<512/16;i++){
-    printf(HEXOUT_STR HEXOUT_STR HEXOUT_STR HEXOUT_STR HEXOUT_STR HEXOUT_STR HEXOUT_STR HEXOUT_STR HEXOUT_STR HEXOUT_STR HEXOUT_STR HEXOUT_STR HEXOUT_STR HEXOUT_STR HEXOUT_STR HEXOUT_STR "\r\n",
-    buffer[i*16],buffer[i*16+1],buffer[i*16+2],buffer[i*16+3],buffer[i*16+4],buffer[i*16+5],buffer[i*16+6],buffer[i*16+7],buffer[i*16+8],buffer[i*16+9],buffer[i*16+10],
-    buffer[i*16+11],buffer[i*16+12],buffer[i*16+13],buffer[i*16+14],buffer[i*16+15]);
-  }
+  //print out buffer, byte addresses would not fit in 32 bits on cards over 4GB so give the sector and offsets in it
+  printf("sector %lu\r\n",sector);
+  hex_dump((unsigned char*)buffer,512,0,flags);
   //free buffer
   BUS_free_buffer();
   return 0;
@@ -386,7 +405,7 @@ int mmc_cardSize(char **argv, unsigned short argc){
   unsigned long size;
   unsigned char CSD[16];
   int resp;
-  resp=mmcReadReg(0x40|9,CSD);
+  resp=io_mmcReadReg(0x40|9,CSD);
   size=mmcGetCardSize(CSD);
   if(resp==MMC_SUCCESS){
     printf("card size = %luKB\r\n",size);
@@ -396,8 +415,20 @@ int mmc_cardSize(char **argv, unsigned short argc){
   return 0;
 }
 
+//most blocks erased with one command by mmce
+#define ERASE_CHUNK   8192
+
+//check that a range that will be written leaves the error log alone
+static int chk_errlog(unsigned long start,unsigned long end){
+  if(errlog_overlaps(start,end)){
+    printf("Error : sectors %lu to %lu are reserved for the error log\r\n",ERRLOG_START,ERRLOG_END);
+    return 1;
+  }
+  return 0;
+}
+
 int mmc_eraseCmd(char **argv, unsigned short argc){
-  unsigned long start,end;
+  unsigned long start,end,cend;
   int resp;
   //check arguments
   if(argc!=2){
@@ -411,40 +442,177 @@ int mmc_eraseCmd(char **argv, unsigned short argc){
     printf("Error : could not parse arguments\r\n");
     return 2;
   }
+  if(chk_errlog(start,end)){
+    return 3;
+  }
   printf("Erasing from %lu to %lu\r\n",start,end);
-  //send erase command
-  resp=mmcErase(start,end);
+  //erased sectors can't be in the cache
+  cache_invalidate(start,end);
+  job_begin(end-start+1);
+  //erase in chunks so a job can show progress and be killed
+  for(resp=MMC_SUCCESS;start<=end && resp==MMC_SUCCESS;start=cend+1){
+    //chunks end on erase unit boundaries so no other blocks are lost
+    cend=start+ERASE_CHUNK-1;
+    cend-=(cend+1)%card_profile.erase_unit;
+    if(cend<start || cend>end){
+      cend=end;
+    }
+    //send erase command
+    resp=SD_erase(start,cend,SD_PRI_HIGH);
+    job_update(cend,cend-start+1);
+    if(job_cancelled()){
+      printf("Cancelled, erased to %lu\r\n",cend);
+      return JOB_CANCELLED;
+    }
+  }
   printf("%s\r\n",SD_error_str(resp));
   return 0;
 }
 
-//data types for TstCmd
-enum{DAT_LFSR=0,DAT_COUNT};
+//number of sector slots in the 2048 byte bus buffer
+#define TST_SLOTS     4
 
-//return next value in data sequence
-char dat_next(char v,int type){
-  switch(type){
-    //next value in the LFSR sequence x^8 + x^6 + x^5 + x^4 + 1
-    case DAT_LFSR:
-      //code taken from: http://en.wikipedia.org/wiki/Linear_feedback_shift_register#Galois_LFSRs
-      return (v>>1)^(-(v&1)&0xB8);
-    //count up by one
-    case DAT_COUNT:
-      return v+1;
-    //unknown type return zero
-    default:
-      printf("Error : unknown type\r\n");
-      return 0;
+//read back sectors from start to end and compare to pattern data
+//lfsr is the pattern state at the start of sector start
+//total byte errors are returned in errors
+static int tst_verify(unsigned char *buffer,unsigned long start,unsigned long end,unsigned char lfsr,int dat,unsigned long *errors){
+  RD_STREAM rs;
+  unsigned char *ptr;
+  unsigned long i;
+  unsigned short count;
+  int resp;
+  //sequential reads are fetched ahead using all sector slots
+  rd_stream_init(&rs,buffer,TST_SLOTS,end);
+  for(i=start,*errors=0;i<=end;i++){
+    //read data from card
+    if((ptr=rd_stream_block(&rs,i,&resp))==NULL){
+      printf("Error : read failure for sector %lu\r\nresp = 0x%04X\r\n%s\r\n",i,resp,SD_error_str(resp));
+      rd_stream_close(&rs);
+      return resp;
+    }
+    //compare sector to psudo random data
+    count=verify_sector(ptr,&lfsr,dat);
+    if(count!=0){
+      printf("%u errors found in sector %lu\r\n",count,i);
+      *errors+=count;
+    }
+    job_update(i,1);
+    if(job_cancelled()){
+      printf("Cancelled at sector %lu\r\n",i);
+      rd_stream_close(&rs);
+      return JOB_CANCELLED;
+    }
+  }
+  rd_stream_close(&rs);
+  return MMC_SUCCESS;
+}
+
+//full period LCG over a range, used to visit sectors in random order
+typedef struct{
+  unsigned long x,c,mask,n;
+}TST_PERM;
+
+//setup to visit each of n values once in an order set by seed
+static void tst_perm_init(TST_PERM *p,unsigned long n,unsigned short seed){
+  //LCG runs over the next power of two so the multiplier and an odd
+  //increment give a full period, values past n are skipped
+  for(p->mask=1;p->mask<n;p->mask=(p->mask<<1)|1);
+  p->n=n;
+  p->c=((unsigned long)seed<<1)|1;
+  p->x=(seed*40503UL)&p->mask;
+}
+
+//get next value in the permutation
+static unsigned long tst_perm_next(TST_PERM *p){
+  do{
+    //multiplier must be 1 mod 4 for a full period
+    p->x=(p->x*1664525UL+p->c)&p->mask;
+  }while(p->x>=p->n);
+  return p->x;
+}
+
+//write and verify sectors in random order
+//each sectors pattern depends only on seed and its offset from start
+static int tst_random(unsigned char *buffer,unsigned long start,unsigned long end,unsigned char seed,int dat,unsigned long *errors){
+  TST_PERM perm;
+  unsigned long i,lba,n=end-start+1;
+  unsigned short count;
+  unsigned char lfsr;
+  unsigned long t;
+  int resp;
+  //write sectors
+  tst_perm_init(&perm,n,seed);
+  t=TA_time();
+  for(i=0;i<n;i++){
+    lba=start+tst_perm_next(&perm);
+    fill_sector(buffer,pat_sector_start(seed,lba-start,dat),dat);
+    resp=io_mmcWriteBlock(lba,buffer);
+    if(resp!=MMC_SUCCESS){
+      printf("Error : write failure for sector %lu\r\nresp = 0x%04X\r\n%s\r\n",lba,resp,SD_error_str(resp));
+      return resp;
+    }
+    job_update(lba,1);
+    if(job_cancelled()){
+      printf("Cancelled after %lu sectors\r\n",i+1);
+      return JOB_CANCELLED;
+    }
+  }
+  t=TA_elapsed(t);
+  printf("random write : %lu sectors in %lu ms, %lu IOPS\r\n",n,TA_ticks_to_ms(t),(n*1000)/(TA_ticks_to_ms(t)?TA_ticks_to_ms(t):1));
+  //read back in a different order
+  tst_perm_init(&perm,n,seed+1);
+  t=TA_time();
+  for(i=0,*errors=0;i<n;i++){
+    lba=start+tst_perm_next(&perm);
+    //clear block data
+    memset(buffer,0,512);
+    resp=io_mmcReadBlock(lba,buffer);
+    if(resp!=MMC_SUCCESS){
+      printf("Error : read failure for sector %lu\r\nresp = 0x%04X\r\n%s\r\n",lba,resp,SD_error_str(resp));
+      return resp;
+    }
+    lfsr=pat_sector_start(seed,lba-start,dat);
+    count=verify_sector(buffer,&lfsr,dat);
+    if(count!=0){
+      printf("%u errors found in sector %lu\r\n",count,lba);
+      *errors+=count;
+    }
+    job_update(lba,1);
+    if(job_cancelled()){
+      printf("Cancelled after %lu sectors\r\n",i+1);
+      return JOB_CANCELLED;
+    }
   }
+  t=TA_elapsed(t);
+  printf("random read : %lu sectors in %lu ms, %lu IOPS, %lu errors\r\n",n,TA_ticks_to_ms(t),(n*1000)/(TA_ticks_to_ms(t)?TA_ticks_to_ms(t):1),*errors);
+  return MMC_SUCCESS;
+}
+
+//pattern generator for mmctst and mmcmw
+typedef struct{
+  unsigned char lfsr;
+  int dat;
+}MW_GEN;
+
+//fill a block for wr_stream_gen
+static int mw_gen(void *ctx,unsigned long addr,unsigned char *buf){
+  MW_GEN *g=ctx;
+  g->lfsr=fill_sector(buf,g->lfsr,g->dat);
+  job_update(addr,1);
+  if(job_cancelled()){
+    printf("Cancelled at block %lu\r\n",addr);
+    return JOB_CANCELLED;
+  }
+  return MMC_SUCCESS;
 }
 
 //write LFSR pattern onto SD card sectors and read it back
 int mmc_TstCmd(char **argv, unsigned short argc){
   int resp;
   char seed,*buffer=NULL;
-  short lfsr;
-  int j,count,tc,dat=DAT_LFSR,have_seed=0;
-  unsigned long i,start,end;
+  int dat=DAT_LFSR,have_seed=0,random=0,pipe=0;
+  MW_GEN g;
+  unsigned long i,start,end,tc;
   if(argc<2){
     printf("Error : Too few arguments\r\n");
     return 1;
@@ -459,6 +627,12 @@ int mmc_TstCmd(char **argv, unsigned short argc){
         dat=DAT_LFSR;
       }else if(!strcmp(argv[i],"count")){
         dat=DAT_COUNT;
+      }else if(!strcmp(argv[i],"pipe")){
+        //generate one half of the buffer while the other half is written
+        pipe=1;
+      }else if(!strcmp(argv[i],"random")){
+        //write and read sectors in random order
+        random=1;
       }else if(!strncmp("seed=",argv[i],sizeof("seed"))){
         //parse seed
         seed=atoi(argv[i]+sizeof("seed"));
@@ -482,6 +656,9 @@ int mmc_TstCmd(char **argv, unsigned short argc){
     printf("Error : could not parse arguments\r\n");
     return 2;
   }
+  if(chk_errlog(start,end)){
+    return 4;
+  }
   //get buffer, set a timeout of 2 secconds
   buffer=BUS_get_buffer(CTL_TIMEOUT_DELAY,2048);
   //check for error
@@ -489,62 +666,40 @@ int mmc_TstCmd(char **argv, unsigned short argc){
     printf("Error : Timeout while waiting for buffer.\r\n");
     return -1;
   }
+  //sectors are written directly so drop them from the cache
+  cache_invalidate(start,end);
   #ifndef ACDS_BUILD
     //TESTING: set line high
     P8OUT|=BIT0;
   #endif
-  //write to sectors
-  for(i=start,lfsr=seed;i<=end;i++){
-    //fill with psudo random data
-    for(j=0;j<512;j++){
-      buffer[j]=lfsr;
-      //print out first few bytes
-      /*if(j<20){
-        printf("0x%02X, ",buffer[j]);
-      }*/
-      //get next in sequence
-      lfsr=dat_next(lfsr,dat);
-    }
-    //printf("\r\n");
-    //write data
-    resp=mmcWriteBlock(i,(unsigned char*)buffer);
-    if(resp!=MMC_SUCCESS){
-      printf("Error : write failure for sector %i\r\nresp = 0x%04X\r\n%s\r\n",i,resp,SD_error_str(resp));
+  //each sector is written and read once
+  job_begin(2*(end-start+1));
+  if(random){
+    if(tst_random((unsigned char*)buffer,start,end,seed,dat,&tc)!=MMC_SUCCESS){
       //free buffer
       BUS_free_buffer();
       return -1;
     }
-  }
-  //read back sectors and check for correctness
-  for(i=start,lfsr=seed,tc=0;i<=end;i++){
-    //clear block data
-    memset(buffer,0,512);
-    //read data from card
-    resp=mmcReadBlock(i,(unsigned char*)buffer);
+  }else{
+    //write to sectors with psudo random data, with pipe each half of the
+    //buffer is one multi block write that the SD task sends while the other half is filled
+    g.lfsr=seed;
+    g.dat=dat;
+    resp=wr_stream_gen(start,end-start+1,mw_gen,&g,(unsigned char*)buffer,pipe?TST_SLOTS:1,pipe);
     if(resp!=MMC_SUCCESS){
-      printf("Error : read failure for sector %i\r\nresp = 0x%04X\r\n%s\r\n",i,resp,SD_error_str(resp));
       //free buffer
       BUS_free_buffer();
-      return -1;
-    }
-    //compare to psudo random data
-    for(j=0,count=0;j<512;j++){
-      //print out the first few bytes
-      /*if(j<20){
-        printf("0x%02X =? 0x%02X, ",lfsr,buffer[j]);
-      }*/
-      if(buffer[j]!=lfsr){
-        count++;
-        //printf("Error found in byte %i in sector %i\r\n",j,i);
-        //printf("Error b%i  s%i\r\n",j,i);
+      if(resp==JOB_CANCELLED){
+        return JOB_CANCELLED;
       }
-      //get next in sequence
-      lfsr=dat_next(lfsr,dat);
+      printf("Error : write failure\r\nresp = 0x%04X\r\n%s\r\n",resp,SD_error_str(resp));
+      return -1;
     }
-    //printf("\r\n");
-    if(count!=0){
-      printf("%i errors found in sector %i\r\n",count,i);
-      tc+=count;
+    //read back sectors and check for correctness
+    if(tst_verify((unsigned char*)buffer,start,end,seed,dat,&tc)!=MMC_SUCCESS){
+      //free buffer
+      BUS_free_buffer();
+      return -1;
     }
   }
   #ifndef ACDS_BUILD
@@ -553,25 +708,193 @@ int mmc_TstCmd(char **argv, unsigned short argc){
   #endif
   if(tc==0){
     printf("All sectors read susussfully!\r\n");
+  }else{
+    printf("%lu errors found\r\n",tc);
   }
   //free buffer
   BUS_free_buffer();
   return 0;
 }
 
-int mmc_multiWTstCmd(char **argv, unsigned short argc){
-  unsigned char *ptr;
+//verify sectors written by mmctst without rewriting them
+int mmc_verifyCmd(char **argv, unsigned short argc){
+  unsigned char *buffer=NULL,seed;
+  int j,dat=DAT_LFSR;
+  unsigned long start,end,base,tc;
+  if(argc<3){
+    printf("Error : Too few arguments\r\n");
+    return 1;
+  }
+  errno=0;
+  start=strtoul(argv[1],NULL,0);
+  end=strtoul(argv[2],NULL,0);
+  seed=strtoul(argv[3],NULL,0);
+  //by default seed is for the first sector checked
+  base=start;
+  //other arguments are optional
+  for(j=4;j<=argc;j++){
+    if(!strcmp(argv[j],"LFSR")){
+      dat=DAT_LFSR;
+    }else if(!strcmp(argv[j],"count")){
+      dat=DAT_COUNT;
+    }else if(!strncmp("base=",argv[j],sizeof("base"))){
+      base=strtoul(argv[j]+sizeof("base"),NULL,0);
+    }else{
+      printf("Error : unknown argument \"%s\".\r\n",argv[j]);
+      return 3;
+    }
+  }
+  if(errno){
+    printf("Error : could not parse arguments\r\n");
+    return 2;
+  }
+  if(start<base || end<start){
+    printf("Error : range %lu to %lu is not after base %lu\r\n",start,end,base);
+    return 4;
+  }
+  //get buffer, set a timeout of 2 secconds
+  buffer=BUS_get_buffer(CTL_TIMEOUT_DELAY,2048);
+  //check for error
+  if(buffer==NULL){
+    printf("Error : Timeout while waiting for buffer.\r\n");
+    return -1;
+  }
+  //make sure the card has data from the cache
+  cache_flush();
+  job_begin(end-start+1);
+  //jump ahead to the pattern state for the first sector
+  if(tst_verify(buffer,start,end,pat_sector_start(seed,start-base,dat),dat,&tc)!=MMC_SUCCESS){
+    //free buffer
+    BUS_free_buffer();
+    return -1;
+  }
+  if(tc==0){
+    printf("All sectors read susussfully!\r\n");
+  }else{
+    printf("%lu errors found\r\n",tc);
+  }
+  //free buffer
+  BUS_free_buffer();
+  return 0;
+}
+
+//send sectors as binary frames for the host receiver
+int mmc_getCmd(char **argv, unsigned short argc){
+  unsigned char *buffer,info[6];
+  unsigned long start,count,i;
+  unsigned short n,k,seq;
+  int resp;
+  if(argc!=2){
+    printf("Error : %s requires two arguments\r\n",argv[0]);
+    return -1;
+  }
+  errno=0;
+  start=strtoul(argv[1],NULL,0);
+  count=strtoul(argv[2],NULL,0);
+  if(errno || count==0){
+    printf("Error : could not parse arguments\r\n");
+    return -2;
+  }
+  //get buffer, set a timeout of 2 secconds
+  buffer=BUS_get_buffer(CTL_TIMEOUT_DELAY,2048);
+  //check for error
+  if(buffer==NULL){
+    printf("Error : Timeout while waiting for buffer.\r\n");
+    return -1;
+  }
+  //make sure the card has data from the cache
+  cache_flush();
+  printf("Sending %lu sectors from %lu\r\n",count,start);
+  for(i=0,seq=0,resp=MMC_SUCCESS;i<count;i+=n){
+    //read as many sectors as fit in the buffer
+    n=(count-i<TST_SLOTS)?count-i:TST_SLOTS;
+    if(n==1){
+      resp=io_mmcReadBlock(start+i,buffer);
+    }else{
+      resp=io_mmcReadBlocks(start+i,n,buffer);
+    }
+    if(resp!=MMC_SUCCESS){
+      //tell receiver where the read failed
+      info[0]=resp;
+      info[1]=resp>>8;
+      info[2]=(start+i);
+      info[3]=(start+i)>>8;
+      info[4]=(start+i)>>16;
+      info[5]=(start+i)>>24;
+      xfer_frame(XFER_ERR,seq,info,6);
+      break;
+    }
+    //send one frame per sector
+    for(k=0;k<n;k++){
+      xfer_frame(XFER_DATA,seq++,buffer+k*512,512);
+    }
+  }
+  //end frame has the number of sectors sent
+  info[0]=i;
+  info[1]=i>>8;
+  info[2]=i>>16;
+  info[3]=i>>24;
+  xfer_frame(XFER_END,seq,info,4);
+  //free buffer
+  BUS_free_buffer();
+  printf("\r\n%s\r\n",SD_error_str(resp));
+  return 0;
+}
+
+//write pattern data to blocks start to end-1 for mmcmw, optionally erasing them first
+//returns the time taken in timer A ticks in *ticks
+static int mw_run(unsigned char *buffer,unsigned long start,unsigned long end,int multi,int pipe,int erase,unsigned char seed,int dat,unsigned long *ticks){
+  MW_GEN g;
+  unsigned long t;
   int stat;
-  unsigned long i,start,end;
-  unsigned short multi=1;
+  #ifndef ACDS_BUILD
+    //TESTING: set line high
+    P8OUT|=BIT0;
+  #endif
+  g.lfsr=seed;
+  g.dat=dat;
+  t=TA_time();
+  //SDlib has no way to send ACMD23 so erase the whole range with CMD38 instead, the time includes the erase
+  if(erase && (stat=SD_erase(start,end-1,SD_PRI_HIGH))!=MMC_SUCCESS){
+    printf("Error erasing blocks. Aborting.\r\n");
+    printf("%s\r\n",SD_error_str(stat));
+  }else{
+    //single writes one block at a time, multi sends each buffer full with one command
+    stat=wr_stream_gen(start,end-start,mw_gen,&g,buffer,multi?card_profile.batch:1,pipe);
+    if(stat!=MMC_SUCCESS && stat!=JOB_CANCELLED){
+      printf("Error with write. %i\r\n",stat);
+      printf("%s\r\n",SD_error_str(stat));
+    }
+  }
+  *ticks=TA_elapsed(t);
+  #ifndef ACDS_BUILD
+    //TESTING: set line low, also on errors so the scope trace ends
+    P8OUT&=~BIT0;
+  #endif
+  return stat;
+}
+
+//print throughput for mmcmw
+static unsigned long mw_print(const char *name,unsigned long blocks,unsigned long ticks){
+  unsigned long ms=TA_ticks_to_ms(ticks),rate;
+  if(ms==0){
+    ms=1;
+  }
+  rate=(blocks*512/1024)*1000/ms;
+  printf("%s : %lu blocks in %lu ms, %lu KB/s\r\n",name,blocks,ms,rate);
+  return rate;
+}
+
+int mmc_multiWTstCmd(char **argv, unsigned short argc){
+  unsigned char *buffer,seed;
+  unsigned long start,end,t,plain,erased,astart,aend;
+  unsigned short multi=1,unit;
+  int erase=0,compare=0,pipe=0,dat=DAT_LFSR,have_seed=0,resp;
+  int i;
   if(argc<2){
     printf("Error : too few arguments\r\n");
     return -1;
   }
-  if(argc>3){
-    printf("Error : too many arguments\r\n");
-    return -2;
-  }
   //get start and end
   errno=0;
   start=strtoul(argv[1],NULL,0);
@@ -580,59 +903,227 @@ int mmc_multiWTstCmd(char **argv, unsigned short argc){
     printf("Error : could not parse arguments\r\n");
     return 2;
   }
-  if(argc>2){
-    if(!strcmp("single",argv[3])){
+  if(end<=start){
+    printf("Error : end must be greater then start\r\n");
+    return 3;
+  }
+  if(chk_errlog(start,end)){
+    return 4;
+  }
+  for(i=3;i<=argc;i++){
+    if(!strcmp("single",argv[i])){
       multi=0;
-    }else if(!strcmp("multi",argv[3])){
+    }else if(!strcmp("multi",argv[i])){
       multi=1;
+    }else if(!strcmp("erase",argv[i])){
+      erase=1;
+    }else if(!strcmp("compare",argv[i])){
+      compare=1;
+    }else if(!strcmp("pipe",argv[i])){
+      pipe=1;
+    }else if(!strcmp("LFSR",argv[i])){
+      dat=DAT_LFSR;
+    }else if(!strcmp("count",argv[i])){
+      dat=DAT_COUNT;
+    }else if(!strncmp("seed=",argv[i],sizeof("seed"))){
+      seed=atoi(argv[i]+sizeof("seed"));
+      have_seed=1;
     }else{
       //unknown argument
-      printf("Error : unknown argument \"%s\".\r\n",argv[3]);
+      printf("Error : unknown argument \"%s\".\r\n",argv[i]);
       return -3;
     }
   }
-  #ifndef ACDS_BUILD
-    //TESTING: set line high
-    P8OUT|=BIT0;
-  #endif
-  if(!multi){
-    //write each block in sequence
-    for(i=start,ptr=NULL;i<end;i++,ptr+=512){
-      if((stat=mmcWriteBlock(i,ptr))!=MMC_SUCCESS){
-        printf("Error writing block %li. Aborting.\r\n",i);
-        printf("%s\r\n",SD_error_str(stat));
-        return 1;
-      }
+  if(!have_seed){
+    //seed LFSR from TAR, must not be zero
+    seed=TAR;
+    if(seed==0){
+      seed=1;
     }
-  }else{
-    //write all blocks with one command
-    if((stat=mmcWriteMultiBlock(start,NULL,end-start))!=MMC_SUCCESS){
-      printf("Error with write. %i\r\n",stat);
-      printf("%s\r\n",SD_error_str(stat));
+  }
+  //cards without ERASE_BLK_EN erase whole erase sectors, so a range that does not line up
+  //with them would take the blocks around it as well. The range is shrunk to whole units
+  //here so both runs of compare write the same blocks
+  if((erase || compare) && !card_profile.erase_blk_en){
+    unit=card_profile.erase_unit;
+    astart=((start+unit-1)/unit)*unit;
+    aend=(end/unit)*unit;
+    if(aend<=astart){
+      printf("Error : range must hold at least one %u block erase unit\r\n",unit);
+      return 5;
+    }
+    if(astart!=start || aend!=end){
+      start=astart;
+      end=aend;
+      printf("Range aligned to the %u block erase unit : %lu to %lu\r\n",unit,start,end-1);
+    }
+  }
+  //get buffer, set a timeout of 2 secconds
+  buffer=BUS_get_buffer(CTL_TIMEOUT_DELAY,2048);
+  //check for error
+  if(buffer==NULL){
+    printf("Error : Timeout while waiting for buffer.\r\n");
+    return -4;
+  }
+  //sectors are written directly so drop them from the cache
+  cache_invalidate(start,end);
+  job_begin(compare?2*(end-start):end-start);
+  if(!compare){
+    resp=mw_run(buffer,start,end,multi,pipe,erase,seed,dat,&t);
+    //free buffer
+    BUS_free_buffer();
+    if(resp!=MMC_SUCCESS){
       return 1;
     }
+    printf("Data written sucussfully\r\n");
+    mw_print(erase?"erase+write":"write",end-start,t);
+    printf("check with: mmcverify %lu %lu %u %s\r\n",start,end-1,seed,(dat==DAT_LFSR)?"LFSR":"count");
+    return 0;
+  }
+  //same range with and without a CMD38 erase of the whole range first
+  if(mw_run(buffer,start,end,multi,pipe,0,seed,dat,&t)!=MMC_SUCCESS){
+    BUS_free_buffer();
+    return 1;
+  }
+  plain=mw_print("write",end-start,t);
+  resp=mw_run(buffer,start,end,multi,pipe,1,seed,dat,&t);
+  //free buffer
+  BUS_free_buffer();
+  if(resp!=MMC_SUCCESS){
+    return 1;
+  }
+  erased=mw_print("erase+write",end-start,t);
+  if(plain){
+    printf("erase then write speedup : %li%%\r\n",(long)(erased*100/plain)-100);
   }
-  #ifndef ACDS_BUILD
-    //TESTING: set line low
-    P8OUT&=~BIT0;
-  #endif
-  printf("Data written sucussfully\r\n");
   return 0;
 }
 
+//what mmcmr does with data in stream mode
+enum{MR_DUMP=0,MR_DISCARD,MR_CRC,MR_VERIFY};
+
+//state for reading a range in chunks
+typedef struct{
+  int mode,dat;
+  //pattern state for verify
+  unsigned char lfsr;
+  unsigned short crc;
+  unsigned long errors;
+}MR_STREAM;
+
+//check data from one chunk
+static void mr_process(MR_STREAM *s,const unsigned char *buf,unsigned long addr,unsigned short n){
+  unsigned short i,count;
+  switch(s->mode){
+    case MR_CRC:
+      s->crc=crc16(s->crc,buf,n*512);
+    break;
+    case MR_VERIFY:
+      for(i=0;i<n;i++){
+        count=verify_sector(buf+i*512,&s->lfsr,s->dat);
+        if(count!=0){
+          printf("%u errors found in sector %lu\r\n",count,addr+i);
+          s->errors+=count;
+        }
+      }
+    break;
+  }
+}
+
+//read blocks start to end-1 in buffer sized chunks
+//with pipe the buffer is split in two and the next chunk is read by the
+//SD task while the current one is checked
+static int mr_stream(MR_STREAM *s,unsigned char *buffer,unsigned long start,unsigned long end,int multi,int pipe){
+  SD_REQ req[2];
+  CTL_EVENT_SET_t evt;
+  unsigned long addr;
+  unsigned short n,chunk;
+  int b,pending,resp=MMC_SUCCESS;
+  //chunk size from the card profile, single block reads use one block chunks
+  chunk=multi?card_profile.batch:1;
+  if(pipe && chunk>CARD_BATCH_MAX/2){
+    chunk=CARD_BATCH_MAX/2;
+  }
+  if(!pipe){
+    for(addr=start;addr<end;addr+=n){
+      n=(end-addr<chunk)?end-addr:chunk;
+      if(n==1){
+        resp=io_mmcReadBlock(addr,buffer);
+      }else{
+        resp=io_mmcReadBlocks(addr,n,buffer);
+      }
+      if(resp!=MMC_SUCCESS){
+        printf("Error reading block %lu.\r\n%s\r\n",addr,SD_error_str(resp));
+        return resp;
+      }
+      mr_process(s,buffer,addr,n);
+      job_update(addr+n-1,n);
+      if(job_cancelled()){
+        printf("Cancelled at block %lu\r\n",addr);
+        return JOB_CANCELLED;
+      }
+    }
+    return MMC_SUCCESS;
+  }
+  ctl_events_init(&evt,0);
+  for(b=0;b<2;b++){
+    req[b].type=SD_REQ_READ;
+    req[b].pri=SD_PRI_LOW;
+    req[b].buf=buffer+b*chunk*512;
+    req[b].done=&evt;
+    req[b].done_evt=1<<b;
+  }
+  //start the first read
+  req[0].addr=start;
+  req[0].count=(end-start<chunk)?end-start:chunk;
+  while(SD_submit(&req[0])){
+    ctl_timeout_wait(ctl_get_current_time()+1);
+  }
+  for(b=0,addr=start;addr<end;addr+=n,b^=1){
+    n=req[b].count;
+    ctl_events_wait(CTL_EVENT_WAIT_ANY_EVENTS_WITH_AUTO_CLEAR,&evt,1<<b,CTL_TIMEOUT_NONE,0);
+    //start reading the next chunk into the other half
+    pending=0;
+    if(req[b].result==MMC_SUCCESS && addr+n<end && !job_cancelled()){
+      req[b^1].addr=addr+n;
+      req[b^1].count=(end-addr-n<chunk)?end-addr-n:chunk;
+      while(SD_submit(&req[b^1])){
+        ctl_timeout_wait(ctl_get_current_time()+1);
+      }
+      pending=1;
+    }
+    if(req[b].result!=MMC_SUCCESS){
+      resp=req[b].result;
+      printf("Error reading block %lu.\r\n%s\r\n",addr,SD_error_str(resp));
+    }else if(job_cancelled()){
+      printf("Cancelled at block %lu\r\n",addr);
+      resp=JOB_CANCELLED;
+    }else{
+      mr_process(s,req[b].buf,addr,n);
+      job_update(addr+n-1,n);
+    }
+    if(resp!=MMC_SUCCESS){
+      //the other read must finish before its request goes out of scope
+      if(pending){
+        ctl_events_wait(CTL_EVENT_WAIT_ANY_EVENTS_WITH_AUTO_CLEAR,&evt,1<<(b^1),CTL_TIMEOUT_NONE,0);
+      }
+      return resp;
+    }
+  }
+  return MMC_SUCCESS;
+}
+
 int mmc_multiRTstCmd(char **argv, unsigned short argc){
-  unsigned char *ptr,*buffer;
+  unsigned char *ptr,*buffer,seed=1;
   int resp;
-  unsigned long i,start,end;
-  unsigned short multi=1;
+  unsigned long i,start,end,base,t;
+  unsigned short multi=1,flags=0;
+  int j,pipe=0,have_base=0;
+  MR_STREAM s;
   if(argc<2){
     printf("Error : too few arguments\r\n");
     return -1;
   }
-  if(argc>3){
-    printf("Error : too many arguments\r\n");
-    return -2;
-  }
   //get start and end
   errno=0;
   start=strtoul(argv[1],NULL,0);
@@ -641,23 +1132,87 @@ int mmc_multiRTstCmd(char **argv, unsigned short argc){
     printf("Error : could not parse arguments\r\n");
     return -4;
   }
-  if((end-start)*512>BUS_get_buffer_size()){
-    printf("Error : data size too large for buffer.\r\n");
-    return -5;
-  }
-  if(argc>2){
-    if(!strcmp("single",argv[3])){
+  s.mode=MR_DUMP;
+  s.dat=DAT_LFSR;
+  s.crc=CRC16_INIT;
+  s.errors=0;
+  //other arguments are optional
+  for(j=3;j<=argc;j++){
+    if(!strcmp("single",argv[j])){
       multi=0;
-    }else if(!strcmp("multi",argv[3])){
+    }else if(!strcmp("multi",argv[j])){
       multi=1;
+    }else if(!strcmp("ascii",argv[j])){
+      flags|=HEX_ASCII;
+    }else if(!strcmp("offset",argv[j])){
+      flags|=HEX_OFFSET;
+    }else if(!strcmp("discard",argv[j])){
+      s.mode=MR_DISCARD;
+    }else if(!strcmp("crc",argv[j])){
+      s.mode=MR_CRC;
+    }else if(!strncmp("verify=",argv[j],sizeof("verify"))){
+      s.mode=MR_VERIFY;
+      seed=strtoul(argv[j]+sizeof("verify"),NULL,0);
+    }else if(!strcmp("LFSR",argv[j])){
+      s.dat=DAT_LFSR;
+    }else if(!strcmp("count",argv[j])){
+      s.dat=DAT_COUNT;
+    }else if(!strncmp("base=",argv[j],sizeof("base"))){
+      base=strtoul(argv[j]+sizeof("base"),NULL,0);
+      have_base=1;
+    }else if(!strcmp("pipe",argv[j])){
+      pipe=1;
     }else{
       //unknown argument
-      printf("Error : unknown argument \"%s\".\r\n",argv[3]);
+      printf("Error : unknown argument \"%s\".\r\n",argv[j]);
       return -3;
     }
   }
+  if(end<=start){
+    printf("Error : end must be greater then start\r\n");
+    return -6;
+  }
+  //only a dump has to fit in the buffer
+  if(s.mode==MR_DUMP && (end-start)*512>BUS_get_buffer_size()){
+    printf("Error : data size too large for buffer.\r\n");
+    return -5;
+  }
+  //seed is for the first sector unless a base is given like mmcverify
+  if(!have_base){
+    base=start;
+  }
+  if(start<base){
+    printf("Error : start is before base\r\n");
+    return -7;
+  }
+  s.lfsr=pat_sector_start(seed,start-base,s.dat);
+  //make sure the card has data from the cache
+  cache_flush();
   //get buffer, set a timeout of 2 secconds
   buffer=BUS_get_buffer(CTL_TIMEOUT_DELAY,2048);
+  //check for error
+  if(buffer==NULL){
+    printf("Error : Timeout while waiting for buffer.\r\n");
+    return -8;
+  }
+  if(s.mode!=MR_DUMP){
+    job_begin(end-start);
+    t=TA_time();
+    resp=mr_stream(&s,buffer,start,end,multi,pipe);
+    t=TA_ticks_to_ms(TA_elapsed(t));
+    //free buffer
+    BUS_free_buffer();
+    if(resp!=MMC_SUCCESS){
+      return 1;
+    }
+    printf("%lu blocks in %lu ms, %lu KB/s\r\n",end-start,t,((end-start)*500)/(t?t:1));
+    if(s.mode==MR_CRC){
+      printf("CRC = 0x%04X\r\n",s.crc);
+    }else if(s.mode==MR_VERIFY){
+      printf("%lu errors\r\n",s.errors);
+    }
+    return 0;
+  }
   #ifndef ACDS_BUILD
     //TESTING: set line high
     P8OUT|=BIT0;
@@ -665,17 +1220,18 @@ int mmc_multiRTstCmd(char **argv, unsigned short argc){
   if(!multi){
     //write each block in sequence
     for(i=start,ptr=buffer;i<end;i++,ptr+=512){
-      if((resp=mmcReadBlock(i,ptr))!=MMC_SUCCESS){
+      if((resp=io_mmcReadBlock(i,ptr))!=MMC_SUCCESS){
         printf("Error reading block %li. Aborting.\r\n",i);     
         printf("%s\r\n",SD_error_str(resp));
         //free buffer
         BUS_free_buffer();
         return 1;   
       }
+      job_update(i,1);
     }
   }else{
     //write all blocks with one command
-    if((resp=mmcReadBlocks(start,end-start,buffer))!=MMC_SUCCESS){
+    if((resp=io_mmcReadBlocks(start,end-start,buffer))!=MMC_SUCCESS){
       printf("Error with read.\r\n");
       printf("resp = 0x%04X\r\n%s\r\n",resp,SD_error_str(resp));
       //free buffer
@@ -687,11 +1243,10 @@ int mmc_multiRTstCmd(char **argv, unsigned short argc){
     //TESTING: set line low
     P8OUT&=~BIT0;
   #endif
-  //print out buffer
-  for(i=0;i<(end-start)*512/16;i++){
-    printf(HEXOUT_STR HEXOUT_STR HEXOUT_STR HEXOUT_STR HEXOUT_STR HEXOUT_STR HEXOUT_STR HEXOUT_STR HEXOUT_STR HEXOUT_STR HEXOUT_STR HEXOUT_STR HEXOUT_STR HEXOUT_STR HEXOUT_STR HEXOUT_STR "\r\n",
-    buffer[i*16],buffer[i*16+1],buffer[i*16+2],buffer[i*16+3],buffer[i*16+4],buffer[i*16+5],buffer[i*16+6],buffer[i*16+7],buffer[i*16+8],buffer[i*16+9],buffer[i*16+10],
-    buffer[i*16+11],buffer[i*16+12],buffer[i*16+13],buffer[i*16+14],buffer[i*16+15]);
+  //print out buffer one sector at a time with offsets in the sector
+  for(i=0;i<end-start;i++){
+    printf("sector %lu\r\n",start+i);
+    hex_dump(buffer+i*512,512,0,flags);
   }
   printf("Data read sucussfully\r\n");
   //free buffer
@@ -699,35 +1254,475 @@ int mmc_multiRTstCmd(char **argv, unsigned short argc){
   return 0;
 }
 
-int mmc_reinit(char **argv, unsigned short argc){
-  int resp;
-  //setup the SD card
-  resp=mmcReInit_card();
-  //set some LEDs
-  #ifndef ACDS_BUILD
-    P7OUT&=~(BIT7|BIT6);
-    if(resp==MMC_SUCCESS){
-      P7OUT|=BIT7;
-    }else{
-      P7OUT|=BIT6;
-    }
-  #endif
-  //print status
-  printf("%s\r\n",SD_error_str(resp));
-  return 0;
+//random number generator for benchmarks
+static unsigned long bench_rand(unsigned long *state){
+  unsigned long hi;
+  //low bits of LCG are poor, use high bits of two steps
+  *state=(*state)*1664525UL+1013904223UL;
+  hi=(*state)>>16;
+  *state=(*state)*1664525UL+1013904223UL;
+  return (hi<<16)|((*state)>>16);
 }
 
-int mmcDMA_Cmd(char **argv, unsigned short argc){
-  if(SD_DMA_is_enabled()){
-    printf("DMA is enabled\r\n");
-  }else{
-    printf("DMA is not enabled\r\n");
+//throughput and latency benchmark
+int mmc_benchCmd(char **argv, unsigned short argc){
+  unsigned char *buffer;
+  unsigned long start,end,span,lba,n,i,rnd,bytes;
+  unsigned short blocks=1;
+  unsigned long t,tstart,ttot;
+  int resp,write=0,random=0,multi=0,j;
+  LAT_STATS lat;
+  if(argc<2){
+    printf("Error : too few arguments\r\n");
+    return -1;
   }
+  errno=0;
+  start=strtoul(argv[1],NULL,0);
+  end=strtoul(argv[2],NULL,0);
+  if(errno || end<start){
+    printf("Error : could not parse arguments\r\n");
+    return -2;
+  }
+  span=end-start+1;
+  n=0;
+  //other arguments are optional
+  for(j=3;j<=argc;j++){
+    if(!strcmp(argv[j],"read")){
+      write=0;
+    }else if(!strcmp(argv[j],"write")){
+      write=1;
+    }else if(!strcmp(argv[j],"seq")){
+      random=0;
+    }else if(!strcmp(argv[j],"rand")){
+      random=1;
+    }else if(!strcmp(argv[j],"single")){
+      multi=0;
+    }else if(!strcmp(argv[j],"multi")){
+      multi=1;
+    }else if(!strncmp("n=",argv[j],sizeof("n"))){
+      n=strtoul(argv[j]+sizeof("n"),NULL,0);
+    }else if(!strncmp("blocks=",argv[j],sizeof("blocks"))){
+      blocks=atoi(argv[j]+sizeof("blocks"));
+    }else{
+      printf("Error : unknown argument \"%s\".\r\n",argv[j]);
+      return -3;
+    }
+  }
+  if(!multi){
+    blocks=1;
+  }else if(blocks<2){
+    blocks=BUS_get_buffer_size()/512;
+  }
+  if(blocks==0 || blocks*512UL>BUS_get_buffer_size() || blocks>span){
+    printf("Error : invalid block count %u\r\n",blocks);
+    return -4;
+  }
+  //reads can't hurt the log
+  if(write && chk_errlog(start,end)){
+    return -5;
+  }
+  //default to one pass over the range
+  if(n==0){
+    n=span/blocks;
+  }
+  //get buffer, set a timeout of 2 secconds
+  buffer=BUS_get_buffer(CTL_TIMEOUT_DELAY,2048);
+  //check for error
+  if(buffer==NULL){
+    printf("Error : Timeout while waiting for buffer.\r\n");
+    return -1;
+  }
+  //fill buffer with a count pattern for writes
+  for(j=0;j<blocks*512;j++){
+    buffer[j]=j;
+  }
+  //card is accessed directly, flush and drop cached sectors
+  if(write){
+    cache_invalidate(start,end);
+  }else{
+    cache_flush();
+  }
+  lat_init(&lat);
+  rnd=TAR;
+  tstart=TA_time();
+  for(i=0,lba=start;i<n;i++){
+    //get next address
+    if(random){
+      lba=start+bench_rand(&rnd)%(span-blocks+1);
+    }else if(lba+blocks-1>end){
+      //wrap around to the start of the range
+      lba=start;
+    }
+    t=TA_time();
+    if(write){
+      if(blocks==1){
+        resp=io_mmcWriteBlock(lba,buffer);
+      }else{
+        resp=io_mmcWriteMultiBlock(lba,buffer,blocks);
+      }
+    }else{
+      if(blocks==1){
+        resp=io_mmcReadBlock(lba,buffer);
+      }else{
+        resp=io_mmcReadBlocks(lba,blocks,buffer);
+      }
+    }
+    t=TA_elapsed(t);
+    if(resp!=MMC_SUCCESS){
+      printf("Error : %s failure for sector %lu\r\nresp = 0x%04X\r\n%s\r\n",write?"write":"read",lba,resp,SD_error_str(resp));
+      //free buffer
+      BUS_free_buffer();
+      return 1;
+    }
+    lat_add(&lat,t);
+    lba+=blocks;
+  }
+  ttot=TA_ticks_to_ms(TA_elapsed(tstart));
+  //free buffer
+  BUS_free_buffer();
+  //don't divide by zero
+  if(ttot==0){
+    ttot=1;
+  }
+  bytes=n*blocks*512;
+  printf("%s %s %s, %lu ops of %u blocks\r\n",random?"random":"sequential",multi?"multi":"single",write?"write":"read",n,blocks);
+  //bytes per ms is about KB/s
+  printf("%lu bytes in %lu ms, %lu KB/s, %lu IOPS\r\n",bytes,ttot,(bytes/1024)*1000/ttot,(n*1000)/ttot);
+  lat_print(&lat);
+  return 0;
+}
+
+//find the end of the error log once the card is up, this is also how the log
+//gets started when there was no card at power up
+static void start_errlog(void){
+  int resp;
+  if((resp=errlog_start())!=MMC_SUCCESS){
+    printf("Error finding end of error log : %s\r\n",SD_error_str(resp));
+  }
+}
+
+int mmc_reinit(char **argv, unsigned short argc){
+  int resp;
+  //write out cached data before the card is reset
+  cache_flush();
+  //setup the SD card
+  resp=io_mmcReInit_card();
+  //card may have changed
+  if(resp==MMC_SUCCESS){
+    //SDlib sets its own clock so use the tuned one again
+    spi_apply_tuned();
+    card_probe();
+    start_errlog();
+  }
+  //set some LEDs
+  #ifndef ACDS_BUILD
+    P7OUT&=~(BIT7|BIT6);
+    if(resp==MMC_SUCCESS){
+      P7OUT|=BIT7;
+    }else{
+      P7OUT|=BIT6;
+    }
+  #endif
+  //print status
+  printf("%s\r\n",SD_error_str(resp));
+  return 0;
+}
+
+//blocks written and read back at each spitune step
+#define TUNE_BLOCKS   CARD_BATCH_MAX
+
+//write and verify LFSR data at the current SPI clock
+//returns the time taken in *ticks and mismatched bytes in *errors
+static int spi_trial(unsigned char *buffer,unsigned long start,unsigned short passes,unsigned long *ticks,unsigned long *errors){
+  unsigned char lfsr,seed;
+  unsigned short p,k;
+  unsigned long t;
+  int resp;
+  *errors=0;
+  *ticks=0;
+  for(p=0;p<passes;p++){
+    //different data each pass, seed must not be zero
+    seed=(p*37)%255+1;
+    for(k=0,lfsr=seed;k<TUNE_BLOCKS;k++){
+      lfsr=fill_sector(buffer+k*512,lfsr,DAT_LFSR);
+    }
+    t=TA_time();
+    if((resp=io_mmcWriteMultiBlock(start,buffer,TUNE_BLOCKS))!=MMC_SUCCESS){
+      return resp;
+    }
+    //stale data must not pass the check
+    memset(buffer,0,TUNE_BLOCKS*512);
+    if((resp=io_mmcReadBlocks(start,TUNE_BLOCKS,buffer))!=MMC_SUCCESS){
+      return resp;
+    }
+    *ticks+=TA_elapsed(t);
+    for(k=0,lfsr=seed;k<TUNE_BLOCKS;k++){
+      *errors+=verify_sector(buffer+k*512,&lfsr,DAT_LFSR);
+    }
+  }
+  return MMC_SUCCESS;
+}
+
+//find the fastest SPI clock that transfers data without errors
+int spituneCmd(char **argv,unsigned short argc){
+  unsigned char *buffer;
+  unsigned long start,ticks,errors,ms;
+  unsigned short passes=8,div,orig,best=0;
+  int save=0,failed=0,restarted=0,resp;
+  int i;
+  if(argc==0){
+    printf("SPI divider = %u, tuned divider = %u\r\n",spi_get_div(),spi_tuned_div);
+    return 0;
+  }
+  if(argc==1 && !strcmp(argv[1],"clear")){
+    //go back to SDlib's clock on the next reinit
+    spi_tuned_div=0;
+    printf("tuned divider cleared\r\n");
+    return 0;
+  }
+  errno=0;
+  start=strtoul(argv[1],NULL,0);
+  if(errno){
+    printf("Error : could not parse arguments\r\n");
+    return -1;
+  }
+  for(i=2;i<=argc;i++){
+    if(!strncmp("n=",argv[i],sizeof("n"))){
+      passes=atoi(argv[i]+sizeof("n"));
+      if(passes==0){
+        printf("Error : bad number of passes\r\n");
+        return -2;
+      }
+    }else if(!strcmp("save",argv[i])){
+      save=1;
+    }else{
+      printf("Error : unknown argument \"%s\".\r\n",argv[i]);
+      return -3;
+    }
+  }
+  if(chk_errlog(start,start+TUNE_BLOCKS-1)){
+    return -5;
+  }
+  //get buffer, set a timeout of 2 secconds
+  buffer=BUS_get_buffer(CTL_TIMEOUT_DELAY,2048);
+  //check for error
+  if(buffer==NULL){
+    printf("Error : Timeout while waiting for buffer.\r\n");
+    return -4;
+  }
+  //test blocks are written directly so drop them from the cache
+  cache_invalidate(start,start+TUNE_BLOCKS-1);
+  //keep other tasks off the card while the clock is out of spec
+  io_card_lock();
+  orig=spi_get_div();
+  printf("Div\tms\tKB/s\tErrors\r\n--------------------------------\r\n");
+  //step the clock up until there is an error
+  for(div=orig;div>=SPI_DIV_MIN;div--){
+    spi_set_div(div);
+    resp=spi_trial(buffer,start,passes,&ticks,&errors);
+    if(resp!=MMC_SUCCESS){
+      printf("%u\t-\t-\t%s\r\n",div,SD_error_str(resp));
+      failed=1;
+      break;
+    }
+    ms=TA_ticks_to_ms(ticks);
+    printf("%u\t%lu\t%lu\t%lu\r\n",div,ms,(2UL*passes*TUNE_BLOCKS*512/1024)*1000/(ms?ms:1),errors);
+    if(errors){
+      failed=1;
+      break;
+    }
+    best=div;
+  }
+  //card may be confused after a failure so start over at a safe clock
+  if(failed){
+    restarted=(io_mmcReInit_card()==MMC_SUCCESS);
+  }
+  //free buffer
+  BUS_free_buffer();
+  if(best==0){
+    spi_set_div(orig);
+    io_card_unlock();
+    //log is read through the SD task so the card must be unlocked
+    if(restarted){
+      start_errlog();
+    }
+    printf("Error : no working divider at or below %u\r\n",orig);
+    return 1;
+  }
+  //leave a step of margin when the limit was found
+  if(failed && best<orig){
+    best++;
+  }
+  printf("best divider = %u\r\n",best);
+  if(save){
+    //used after every reinit from now on
+    spi_tuned_div=best;
+    spi_set_div(best);
+    printf("divider saved\r\n");
+  }else{
+    spi_set_div(orig);
+  }
+  io_card_unlock();
+  if(restarted){
+    start_errlog();
+  }
+  return 0;
+}
+
+int mmcDMA_Cmd(char **argv, unsigned short argc){
+  if(SD_DMA_is_enabled()){
+    printf("DMA is enabled\r\n");
+  }else{
+    printf("DMA is not enabled\r\n");
+  }
+  return 0;
+}
+
+//run ops transfers of blocks blocks at start for dmabench
+//returns throughput in KB/s and the percent of CPU time other tasks got
+static int dma_work(unsigned char *buffer,unsigned long start,unsigned short blocks,unsigned short ops,int write,unsigned long *rate,unsigned long *free){
+  PROF_SNAP snap;
+  CTL_TIME_t total,other;
+  unsigned long t;
+  unsigned short i;
+  int resp=MMC_SUCCESS;
+  prof_snapshot(&snap);
+  t=TA_time();
+  for(i=0;i<ops && resp==MMC_SUCCESS;i++){
+    if(write){
+      resp=(blocks==1)?io_mmcWriteBlock(start,buffer):io_mmcWriteMultiBlock(start,buffer,blocks);
+    }else{
+      resp=(blocks==1)?io_mmcReadBlock(start,buffer):io_mmcReadBlocks(start,blocks,buffer);
+    }
+  }
+  t=TA_ticks_to_ms(TA_elapsed(t));
+  prof_delta(&snap,ctl_task_executing,&total,&other);
+  if(resp!=MMC_SUCCESS){
+    printf("Error : %s\r\n",SD_error_str(resp));
+    return resp;
+  }
+  *rate=((unsigned long)ops*blocks*500)/(t?t:1);
+  *free=total?(other*100)/total:0;
+  return MMC_SUCCESS;
+}
+
+//compare throughput and CPU use of single and multi block transfers in the current SPI mode
+//dmabench results for one DMA setting
+typedef struct{
+  unsigned short magic,ops,blocks;
+  unsigned long rate[4],free[4];
+}DMA_RESULT;
+
+#define DMA_RESULT_MAGIC    0xD3A5
+
+//results are kept on the card after the test blocks, one for each DMA setting
+//SDlib can only change the setting at build time so each build adds its own
+//results and the table shows both once both builds have been run
+#define DMA_RESULT_BLOCK(start)   ((start)+CARD_BATCH_MAX)
+
+int dmabenchCmd(char **argv,unsigned short argc){
+  const char *const names[4]={"read single","read multi","write single","write multi"};
+  unsigned char *buffer,lfsr;
+  unsigned long start;
+  unsigned short ops=64,blocks=card_profile.batch,k;
+  DMA_RESULT now,*saved;
+  int i,resp,dma=SD_DMA_is_enabled()?1:0;
+  if(argc<1){
+    printf("Error : too few arguments\r\n");
+    return -1;
+  }
+  errno=0;
+  start=strtoul(argv[1],NULL,0);
+  if(errno){
+    printf("Error : could not parse arguments\r\n");
+    return -2;
+  }
+  //multi block tests need at least 2 blocks even if the card profile batch is 1
+  if(blocks<2){
+    blocks=2;
+  }
+  for(i=2;i<=argc;i++){
+    if(!strncmp("n=",argv[i],sizeof("n"))){
+      ops=atoi(argv[i]+sizeof("n"));
+    }else if(!strncmp("blocks=",argv[i],sizeof("blocks"))){
+      blocks=atoi(argv[i]+sizeof("blocks"));
+    }else{
+      printf("Error : unknown argument \"%s\".\r\n",argv[i]);
+      return -3;
+    }
+  }
+  if(ops==0 || blocks<2 || blocks>CARD_BATCH_MAX){
+    printf("Error : n must be nonzero and blocks 2 to %u\r\n",CARD_BATCH_MAX);
+    return -4;
+  }
+  if(chk_errlog(start,DMA_RESULT_BLOCK(start))){
+    return -6;
+  }
+  //get buffer, set a timeout of 2 secconds
+  buffer=BUS_get_buffer(CTL_TIMEOUT_DELAY,2048);
+  //check for error
+  if(buffer==NULL){
+    printf("Error : Timeout while waiting for buffer.\r\n");
+    return -5;
+  }
+  //write tests use pattern data
+  for(k=0,lfsr=1;k<blocks;k++){
+    lfsr=fill_sector(buffer+k*512,lfsr,DAT_LFSR);
+  }
+  //test blocks are written directly so drop them from the cache
+  cache_flush();
+  cache_invalidate(start,DMA_RESULT_BLOCK(start));
+  printf("\r\nDMA is %s, %u ops, %u blocks for multi\r\n",dma?"enabled":"disabled",ops,blocks);
+  now.magic=DMA_RESULT_MAGIC;
+  now.ops=ops;
+  now.blocks=blocks;
+  for(i=0;i<4;i++){
+    resp=dma_work(buffer,start,(i&1)?blocks:1,ops,i>>1,&now.rate[i],&now.free[i]);
+    if(resp!=MMC_SUCCESS){
+      //free buffer
+      BUS_free_buffer();
+      return 1;
+    }
+  }
+  //add these results to the ones saved by the other build
+  saved=(DMA_RESULT*)buffer;
+  if((resp=io_mmcReadBlock(DMA_RESULT_BLOCK(start),buffer))!=MMC_SUCCESS){
+    printf("Error reading saved results : %s\r\n",SD_error_str(resp));
+    memset(buffer,0,512);
+  }
+  if(saved[!dma].magic!=DMA_RESULT_MAGIC || saved[!dma].ops!=ops || saved[!dma].blocks!=blocks){
+    //nothing to compare with
+    saved[!dma].magic=0;
+  }
+  saved[dma]=now;
+  if((resp=io_mmcWriteBlock(DMA_RESULT_BLOCK(start),buffer))!=MMC_SUCCESS){
+    printf("Error saving results : %s\r\n",SD_error_str(resp));
+  }
+  printf("\t\tDMA\t\tno DMA\r\nTest\t\tKB/s\tCPU free\tKB/s\tCPU free\r\n------------------------------------------------\r\n");
+  for(i=0;i<4;i++){
+    printf("%s",names[i]);
+    for(k=0;k<2;k++){
+      //DMA column first
+      if(saved[!k].magic==DMA_RESULT_MAGIC){
+        printf("\t%lu\t%lu%%\t",saved[!k].rate[i],saved[!k].free[i]);
+      }else{
+        printf("\t-\t-\t");
+      }
+    }
+    printf("\r\n");
+  }
+  if(saved[!dma].magic!=DMA_RESULT_MAGIC){
+    printf("run with the same arguments on a build with DMA %s to compare\r\n",dma?"disabled":"enabled");
+  }
+  //free buffer
+  BUS_free_buffer();
   return 0;
 }
 
 int mmcreg_Cmd(char**argv,unsigned short argc){
   unsigned char dat[16],reg;
+  CSD_INFO csd;
+  CID_INFO cid;
   int resp;
   int i;
   //check number of arguments
@@ -745,7 +1740,7 @@ int mmcreg_Cmd(char**argv,unsigned short argc){
     return -2;
   }
   //read register
-  resp=mmcReadReg(reg,dat);
+  resp=io_mmcReadReg(reg,dat);
   //check for success
   if(resp!=MMC_SUCCESS){
     printf("%s\r\n",SD_error_str(resp));
@@ -757,6 +1752,14 @@ int mmcreg_Cmd(char**argv,unsigned short argc){
   }
   //add new line
   printf("\r\n");
+  //print decoded fields
+  if(reg==(0x40|9)){
+    csd_decode(dat,&csd);
+    csd_print(&csd);
+  }else{
+    cid_decode(dat,&cid);
+    cid_print(&cid);
+  }
   //return
   return 0;
 }
@@ -776,24 +1779,368 @@ int mmcInitChkCmd(char**argv,unsigned short argc){
 //print the status of each tasks stack
 int stackCmd(char **argv,unsigned short argc){
   extern CTL_TASK_t *ctl_task_list;
-  int i;
   CTL_TASK_t *t=ctl_task_list;
+  const STACK_INFO *s;
+  unsigned short peak,size,total=0,used=0;
   //format string
-  const char *fmt="%-10s\t%lp\t%lp\t%li\r\n";
+  const char *fmt="%-10s\t%lp\t%lp\t%li\t\t";
+  if(argc>1){
+    printf("Error : too many arguments\r\n");
+    return -1;
+  }
+  if(argc==1){
+    if(strcmp(argv[1],"reset")){
+      printf("Error : unknown argument \"%s\".\r\n",argv[1]);
+      return -2;
+    }
+    //start a new peak measurement
+    stack_reset();
+    printf("Stack peaks reset\r\n");
+    return 0;
+  }
   //print out nice header
-  printf("\r\nName\tPointer\tStart\tRemaining\r\n--------------------------------------------------------------------\r\n");
+  printf("\r\nName\t\tPointer\tStart\tRemaining\tSize\tPeak\tGuard\r\n--------------------------------------------------------------------\r\n");
   //loop through tasks and print out info
   while(t!=NULL){
     printf(fmt,t->name,t->stack_pointer,t->stack_start,t->stack_pointer-t->stack_start);
+    //peak usage is only known for stacks that were filled in main
+    if((s=stack_find(t))!=NULL){
+      size=s->words-2;
+      peak=stack_peak(s);
+      total+=size;
+      used+=peak;
+      printf("%u\t%u\t%s\r\n",size,peak,stack_guard_ok(s)?"ok":"BAD");
+    }else{
+      printf("-\t-\t-\r\n");
+    }
     t=t->next;
   }
+  printf("\r\n%u words allocated, %u peak, %u unused\r\n",total,used,total-used);
   //add a blank line after table
   printf("\r\n");
   return 0;
 }
 
+//enable, disable or flush the sector cache
+int cacheCmd(char **argv,unsigned short argc){
+  int resp=MMC_SUCCESS;
+  if(argc>1){
+    printf("Error : too many arguments\r\n");
+    return -1;
+  }
+  if(argc==1){
+    if(!strcmp(argv[1],"on")){
+      resp=cache_enable(1);
+    }else if(!strcmp(argv[1],"off")){
+      resp=cache_enable(0);
+    }else if(!strcmp(argv[1],"flush")){
+      resp=cache_flush();
+    }else{
+      printf("Error : unknown argument \"%s\".\r\n",argv[1]);
+      return -2;
+    }
+  }
+  if(resp!=MMC_SUCCESS){
+    printf("Error writing cache : %s\r\n",SD_error_str(resp));
+  }
+  printf("cache is %s, %u lines\r\n",cache_is_enabled()?"enabled":"disabled",SD_CACHE_LINES);
+  return 0;
+}
+
+//print sector cache statistics
+int cachestatCmd(char **argv,unsigned short argc){
+  SD_CACHE_STATS st;
+  cache_get_stats(&st);
+  printf("hits       %lu\r\n""misses     %lu\r\n""evictions  %lu\r\n""writebacks %lu\r\n",st.hits,st.misses,st.evictions,st.writebacks);
+  if(argc==1 && !strcmp(argv[1],"reset")){
+    cache_clear_stats();
+  }
+  return 0;
+}
+
+//print write coalescing statistics
+int wcstatCmd(char **argv,unsigned short argc){
+  WR_STREAM_STATS st;
+  wr_stream_get_stats(&st);
+  printf("blocks     %lu\r\n""transfers  %lu\r\n""merged     %lu\r\n",st.blocks,st.transfers,st.merged);
+  //SDlib can't send ACMD23 so these writes went out without a pre-erase count
+  printf("pre-erase  %lu not sent\r\n",st.pre_erase);
+  if(argc==1 && !strcmp(argv[1],"reset")){
+    wr_stream_clear_stats();
+  }
+  return 0;
+}
+
+//get/set read ahead window
+int readaheadCmd(char **argv,unsigned short argc){
+  unsigned short val;
+  if(argc>1){
+    printf("Error : too many arguments\r\n");
+    return -1;
+  }
+  if(argc==1){
+    if(!strcmp(argv[1],"auto")){
+      //follow the card profile
+      val=0;
+    }else if((val=atoi(argv[1]))==0){
+      printf("Error : bad value.\r\n");
+      return -2;
+    }
+    rd_stream_window=val;
+  }
+  printf("read ahead window = %u blocks%s\r\n",rd_stream_get_window(),rd_stream_window?"":" from card profile");
+  return 0;
+}
+
+//print read ahead statistics
+int rastatCmd(char **argv,unsigned short argc){
+  RD_STREAM_STATS st;
+  rd_stream_get_stats(&st);
+  printf("blocks     %lu\r\n""hits       %lu\r\n""prefetched %lu\r\n""wasted     %lu\r\n",st.blocks,st.hits,st.prefetched,st.wasted);
+  if(st.prefetched){
+    printf("hit rate   %lu%%\r\n",(st.hits*100)/st.prefetched);
+  }
+  if(argc==1 && !strcmp(argv[1],"reset")){
+    rd_stream_clear_stats();
+  }
+  return 0;
+}
+
+//print SD request queue statistics
+int sdqCmd(char **argv,unsigned short argc){
+  SD_QUEUE_STATS st[SD_NUM_PRI];
+  const char *names[SD_NUM_PRI]={"high","low"};
+  int i;
+  SD_get_queue_stats(st);
+  printf("\r\nQueue\tDepth\tMax\tRequests\tRejected\tAvg Wait\tMax Wait\tAvg Service\r\n--------------------------------------------------------------------\r\n");
+  for(i=0;i<SD_NUM_PRI;i++){
+    printf("%s\t%u\t%u\t%lu\t\t%lu\t\t%lums\t\t%lums\t\t%lums\r\n",names[i],SD_queue_depth(i),st[i].max_depth,st[i].requests,st[i].rejected,
+           st[i].requests?TA_ticks_to_ms(st[i].wait_total/st[i].requests):0,TA_ticks_to_ms(st[i].wait_max),
+           st[i].requests?TA_ticks_to_ms(st[i].service_total/st[i].requests):0);
+  }
+  printf("\r\n");
+  if(argc==1 && !strcmp(argv[1],"reset")){
+    SD_clear_queue_stats();
+  }
+  return 0;
+}
+
+//print SD operation statistics
+int iostatCmd(char **argv,unsigned short argc){
+  IO_STATS st;
+  int i;
+  printf("\r\nOp\tCalls\tBlocks\tErrors\tLate\tAvg us\t50%% us\t99%% us\tMax us\r\n--------------------------------------------------------------------\r\n");
+  for(i=0;i<IO_NUM_OPS;i++){
+    io_get_stats(i,&st);
+    if(st.lat.count==0){
+      printf("%s\t0\r\n",io_op_name(i));
+      continue;
+    }
+    printf("%s\t%lu\t%lu\t%lu\t%lu\t%lu\t%lu\t%lu\t%lu\r\n",io_op_name(i),st.lat.count,st.blocks,st.errors,st.late,
+           TA_ticks_to_us(st.lat.sum/st.lat.count),TA_ticks_to_us(lat_percentile(&st.lat,50)),
+           TA_ticks_to_us(lat_percentile(&st.lat,99)),TA_ticks_to_us(st.lat.max));
+  }
+  printf("\r\n");
+  if(argc==1 && !strcmp(argv[1],"reset")){
+    io_clear_stats();
+  }
+  return 0;
+}
+
+//show or update the card profile
+int cardCmd(char **argv,unsigned short argc){
+  int resp;
+  if(argc>1){
+    printf("Error : too many arguments\r\n");
+    return -1;
+  }
+  if(argc==1){
+    if(strcmp(argv[1],"probe")){
+      printf("Error : unknown argument \"%s\".\r\n",argv[1]);
+      return -2;
+    }
+    if((resp=card_probe())!=MMC_SUCCESS){
+      printf("Error reading CSD : %s\r\n",SD_error_str(resp));
+      return -3;
+    }
+  }
+  card_print_profile();
+  return 0;
+}
+
+//measure CPU usage of each task
+int cpuCmd(char **argv,unsigned short argc){
+  PROF_SNAP snap;
+  unsigned long window=PROF_WINDOW_DEFAULT;
+  int bg=0;
+  char *end;
+  int i;
+  for(i=1;i<=argc;i++){
+    if(!strcmp(argv[i],"on")){
+      bg=1;
+    }else if(!strcmp(argv[i],"off")){
+      prof_stop();
+      return 0;
+    }else{
+      window=strtoul(argv[i],&end,10);
+      if(*end || window<PROF_WINDOW_MIN || window>PROF_WINDOW_MAX){
+        printf("Error : window must be %u to %u ms\r\n",PROF_WINDOW_MIN,PROF_WINDOW_MAX);
+        return -1;
+      }
+    }
+  }
+  if(bg){
+    prof_start(window);
+    printf("Printing CPU usage every %lu ms. Use \"cpu off\" to stop\r\n",window);
+    return 0;
+  }
+  //measure one window
+  prof_snapshot(&snap);
+  ctl_timeout_wait(snap.time+(window*1024)/1000);
+  prof_print(&snap);
+  return 0;
+}
+
+//run a command as a background job
+int bgCmd(char **argv,unsigned short argc){
+  const CMD_SPEC *cmd;
+  int resp;
+  if(argc<1){
+    printf("Error : too few arguments\r\n");
+    return -1;
+  }
+  for(cmd=cmd_tbl;cmd->name!=NULL;cmd++){
+    if(!strcmp(cmd->name,argv[1])){
+      break;
+    }
+  }
+  if(cmd->name==NULL || cmd->cmd==bgCmd){
+    printf("Error : can't run \"%s\" as a job\r\n",argv[1]);
+    return -2;
+  }
+  if((resp=job_start(cmd,argv+1,argc-1))!=0){
+    printf("Error : %s\r\n",(resp==1)?"a job is already running":"command line too long");
+    return -3;
+  }
+  printf("job \"%s\" started\r\n",argv[1]);
+  return 0;
+}
+
+//list background jobs
+int jobsCmd(char **argv,unsigned short argc){
+  const JOB *job=job_get();
+  int i;
+  if(!job->running){
+    printf("no jobs running\r\n");
+    return 0;
+  }
+  printf("[1] %s",job->cancel?"stopping":"running");
+  for(i=0;i<=job->argc;i++){
+    printf(" %s",job->argv[i]);
+  }
+  printf("\r\n");
+  return 0;
+}
+
+//show progress of the background job
+int progressCmd(char **argv,unsigned short argc){
+  const JOB *job=job_get();
+  unsigned long ms,done,total;
+  if(!job->running){
+    printf("no jobs running\r\n");
+    return 0;
+  }
+  ms=TA_ticks_to_ms(TA_elapsed(job->started));
+  done=job->done;
+  total=job->total;
+  printf("%s : ",job->argv[0]);
+  if(total){
+    printf("%lu%% ",(done>=total)?100:(done*100)/total);
+  }
+  //blocks per ms times 512/1024 is KB/s
+  printf("%lu blocks, LBA %lu, %lu s, %lu KB/s\r\n",done,job->lba,ms/1000,(done*500)/(ms?ms:1));
+  return 0;
+}
+
+//stop the background job
+int killCmd(char **argv,unsigned short argc){
+  const JOB *job=job_get();
+  int i;
+  if(job_kill()){
+    printf("no jobs running\r\n");
+    return 0;
+  }
+  //give the job a chance to clean up
+  for(i=0;i<20 && job->running;i++){
+    ctl_timeout_wait(ctl_get_current_time()+102);
+  }
+  if(job->running){
+    printf("job will stop after the current transfer\r\n");
+  }
+  return 0;
+}
+
+//get/set calibrated timer A frequency
+int tafreqCmd(char **argv,unsigned short argc){
+  unsigned long val;
+  if(argc>1){
+    printf("Error : too many arguments\r\n");
+    return -1;
+  }
+  if(argc==1){
+    val=strtoul(argv[1],NULL,0);
+    //only allow small corrections to the crystal frequency
+    if(val<TA_FREQ_NOMINAL-TA_FREQ_NOMINAL/100 || val>TA_FREQ_NOMINAL+TA_FREQ_NOMINAL/100){
+      printf("Error : bad value.\r\n");
+      return -2;
+    }
+    TA_freq=val;
+  }
+  printf("TA_freq = %luHz\r\ntime = %lu ticks\r\n",TA_freq,TA_time());
+  return 0;
+}
+
 int replayCmd(char **argv,unsigned short argc){
-  error_log_replay();
+  ERRLOG_FILTER filter;
+  unsigned char *buffer;
+  int i,resp;
+  errlog_filter_init(&filter);
+  for(i=1;i<=argc;i++){
+    if(!strcmp(argv[i],"direct")){
+      //replay report_error log, error log reads the card directly
+      cache_sync();
+      error_log_replay();
+      return 0;
+    }else if(!strncmp("level=",argv[i],sizeof("level"))){
+      filter.level=atoi(argv[i]+sizeof("level"));
+    }else if(!strncmp("source=",argv[i],sizeof("source"))){
+      filter.source=atoi(argv[i]+sizeof("source"));
+      filter.any_source=0;
+    }else if(!strncmp("from=",argv[i],sizeof("from"))){
+      filter.from=strtoul(argv[i]+sizeof("from"),NULL,0);
+    }else if(!strncmp("to=",argv[i],sizeof("to"))){
+      filter.to=strtoul(argv[i]+sizeof("to"),NULL,0);
+    }else if(!strncmp("last=",argv[i],sizeof("last"))){
+      filter.last=strtoul(argv[i]+sizeof("last"),NULL,0);
+    }else{
+      printf("Error : unknown argument \"%s\".\r\n",argv[i]);
+      return -1;
+    }
+  }
+  //get buffer, set a timeout of 2 secconds
+  buffer=BUS_get_buffer(CTL_TIMEOUT_DELAY,2048);
+  //check for error
+  if(buffer==NULL){
+    printf("Error : Timeout while waiting for buffer.\r\n");
+    return -2;
+  }
+  resp=errlog_replay(&filter,buffer);
+  //free buffer
+  BUS_free_buffer();
+  if(resp!=MMC_SUCCESS){
+    printf("Error reading log : %s\r\n",SD_error_str(resp));
+    return 1;
+  }
   return 0;
 }
 
@@ -803,31 +2150,108 @@ int reportCmd(char **argv,unsigned short argc){
     printf("Error : %s requires 4 arguments but %i given.\r\n",argv[0],argc);
     return 1;
   }
-  report_error(atoi(argv[1]),atoi(argv[2]),atoi(argv[3]),atoi(argv[4]));
+  //staged in RAM and written by the error log task
+  if(errlog_report(atoi(argv[1]),atoi(argv[2]),atoi(argv[3]),atoi(argv[4]))){
+    printf("Error : log buffer full, error dropped\r\n");
+  }
   return 0;
 }
 
 //clear saved errors from the SD card
 int clearCmd(char **argv,unsigned short argc){
   int ret;
+  //error log erases the card directly
+  cache_sync();
   ret=clear_saved_errors();
   if(ret){
     printf("Error erasing errors : %s\r\n",SD_error_str(ret));
   }
+  //start the RAM staged log over too
+  ret=errlog_clear();
+  if(ret){
+    printf("Error clearing error log : %s\r\n",SD_error_str(ret));
+  }
   return 0;
 }
 
+//print records per second for espam
+static void spam_rate(const char *name,int num,unsigned long ticks){
+  unsigned long ms=TA_ticks_to_ms(ticks);
+  printf("%s : %i errors in %lu ms, %lu errors/s\r\n",name,num,ms,((unsigned long)num*1000)/(ms?ms:1));
+}
+
 int errSpamCmd(char **argv,unsigned short argc){
-  int num,i;
-  if(argc>=1){
-    num=atoi(argv[1]);
-  }else{
-    num=10;
+  ERRLOG_STATS before,after;
+  unsigned long t,staged,written;
+  int num=10,i,direct=0;
+  int resp;
+  for(i=1;i<=argc;i++){
+    if(!strcmp(argv[i],"direct")){
+      direct=1;
+    }else{
+      num=atoi(argv[i]);
+    }
+  }
+  if(direct){
+    //error log writes the card directly
+    cache_sync();
+    t=TA_time();
+    for(i=0;i<num;i++){
+      report_error(1,-1,-1,i);
+    }
+    spam_rate("direct",num,TA_elapsed(t));
+    return 0;
   }
+  errlog_get_stats(&before);
+  t=TA_time();
   for(i=0;i<num;i++){
-    report_error(1,-1,-1,i);
+    errlog_report(1,-1,-1,i);
+  }
+  staged=TA_elapsed(t);
+  //time until everything is on the card
+  resp=errlog_sync();
+  written=TA_elapsed(t);
+  //dropped errors never reach the card so leave them out of the rates
+  errlog_get_stats(&after);
+  num-=after.dropped-before.dropped;
+  spam_rate("staged",num,staged);
+  spam_rate("written",num,written);
+  if(resp!=MMC_SUCCESS){
+    printf("Error writing log : %s\r\n",SD_error_str(resp));
+  }
+  printf("%lu errors dropped\r\n",after.dropped-before.dropped);
+  return 0;
+}
+
+//error log statistics and settings
+int errlogCmd(char **argv,unsigned short argc){
+  ERRLOG_STATS st;
+  unsigned long val;
+  int i,resp;
+  for(i=1;i<=argc;i++){
+    if(!strcmp(argv[i],"sync")){
+      if((resp=errlog_sync())!=MMC_SUCCESS){
+        printf("Error writing log : %s\r\n",SD_error_str(resp));
+      }
+    }else if(!strcmp(argv[i],"reset")){
+      errlog_clear_stats();
+    }else if(!strncmp("deadline=",argv[i],sizeof("deadline"))){
+      val=strtoul(argv[i]+sizeof("deadline"),NULL,0);
+      if(val==0 || val>60000){
+        printf("Error : deadline must be 1 to 60000 ms\r\n");
+        return -1;
+      }
+      errlog_deadline=val;
+    }else{
+      printf("Error : unknown argument \"%s\".\r\n",argv[i]);
+      return -2;
+    }
   }
-  printf("%i errors recorded\r\n",num);
+  errlog_get_stats(&st);
+  printf("log sectors %lu to %lu, deadline %u ms, next sector %lu\r\n",ERRLOG_START,ERRLOG_END,errlog_deadline,errlog_position());
+  printf("reported %lu, dropped %lu, written %lu, max depth %u/%u\r\n",st.reported,st.dropped,st.written,st.max_depth,ERRLOG_RING_LEN);
+  printf("sector writes : full %lu, deadline %lu, forced %lu, errors %lu\r\n",st.full,st.deadline,st.forced,st.errors);
+  printf("index updates %lu, errors %lu\r\n",st.indexed,st.index_errors);
   return 0;
 }
 
@@ -841,21 +2265,41 @@ const CMD_SPEC cmd_tbl[]={{"help"," [command]\r\n\t""get a list of commands or h
                          {"async","\r\n\t""Close async connection.",asyncCmd},
                          {"exit","\r\n\t""Close async connection.",asyncCmd},                 //nice for those of us who are used to typing exit
                          {"mmcr","\r\n\t""read string from mmc card.",mmc_read},
-                         {"mmcdump","[sector]\r\n\t""dump a sector from MMC card.",mmc_dump},
+                         {"mmcdump","[sector] [ascii] [offset]\r\n\t""dump a sector from MMC card.",mmc_dump},
+                         {"mmcget","start count\r\n\t""send sectors as binary frames for mmcget_rx.",mmc_getCmd},
                          {"mmcw","[data,..]\r\n\t""write data to mmc card.",mmc_write},
                          {"mmcsize","\r\n\t""get card size.",mmc_cardSize},
                          {"mmce","start end\r\n\t""erase sectors from start to end",mmc_eraseCmd},
-                         {"mmctst","start end [seed]\r\n\t""Test by writing to blocks from start to end.",mmc_TstCmd},
-                         {"mmcmw","start end [single|multi]\r\n\t""Multi block write test.",mmc_multiWTstCmd},
-                         {"mmcmr","start end [single|multi]\r\n\t""Multi block read test.",mmc_multiRTstCmd},
+                         {"mmctst","start end [LFSR|count] [seed=n] [pipe|random]\r\n\t""Test by writing to blocks from start to end. pipe fills half the buffer while the SD task writes the other half, random visits sectors in random order.",mmc_TstCmd},
+                         {"mmcverify","start end seed [LFSR|count] [base=sector]\r\n\t""Verify sectors written by mmctst. base is the start sector of the mmctst run.",mmc_verifyCmd},
+                         {"mmcmw","start end [single|multi] [erase|compare] [LFSR|count] [seed=n] [pipe]\r\n\t""Multi block write test with pattern data for mmcverify. erase erases the whole range with CMD38 before writing and the time includes the erase, compare times the write with and without it. Both shrink the range to whole erase units. pipe generates data while the last chunk is written.",mmc_multiWTstCmd},
+                         {"mmcmr","start end [single|multi] [ascii] [offset] [discard|crc|verify=seed [LFSR|count] [base=n]] [pipe]\r\n\t""Multi block read test. discard, crc and verify read any size range in chunks and report throughput, pipe overlaps reads with checking.",mmc_multiRTstCmd},
+                         {"mmcbench","start end [read|write] [seq|rand] [single|multi] [n=ops] [blocks=k]\r\n\t""Throughput and latency benchmark. writes destroy data.",mmc_benchCmd},
                          {"mmcreinit","\r\n\t""initialize the mmc card the mmc card.",mmc_reinit},
                          {"DMA","\r\n\t""Check if DMA is enabled.",mmcDMA_Cmd},
-                         {"mmcreg","[CID|CSD]\r\n\t""Read SD card registers.",mmcreg_Cmd},
+                         {"dmabench","start [n=ops] [blocks=k]\r\n\t""Time single and multi block transfers and the CPU left for other tasks. Results are saved after the test blocks and shown next to the ones from a build with the other DMA setting. destroys data at start.",dmabenchCmd},
+                         {"mmcreg","[CID|CSD]\r\n\t""Read and decode SD card registers.",mmcreg_Cmd},
                          {"mmcinitchk","\r\n\t""Check if the SD card is initialized",mmcInitChkCmd},
-                         {"stack","\r\n\t""Print task stack status",stackCmd},
-                         {"replay","\r\n\t""Replay errors from log",replayCmd},
+                         {"stack","[reset]\r\n\t""Print task stack status and peak usage. reset starts a new peak measurement.",stackCmd},
+                         {"replay","[level=n] [source=n] [from=t] [to=t] [last=n] [direct]\r\n\t""Replay errors from log. Only sectors that can match are read. direct replays the report_error log.",replayCmd},
                          {"report","lev src err arg\r\n\t""Report an error",reportCmd},
-                         {"clear","\r\n\t""Clear all saved errors on the SD card",clearCmd},
-                         {"espam","[num]\r\n\t""Generate num bogus errors for testing purposes",errSpamCmd},
+                         {"clear","\r\n\t""Clear all saved errors on the SD card and start the error log over",clearCmd},
+                         {"espam","[num] [direct]\r\n\t""Generate num bogus errors and time them. direct uses report_error instead of the RAM log.",errSpamCmd},
+                         {"errlog","[sync] [reset] [deadline=ms]\r\n\t""Print error log statistics, write staged errors or set the flush deadline.\r\n\t""Test commands refuse to write over the sectors used by the log.",errlogCmd},
+                         {"cache","[on|off|flush]\r\n\t""Get/set sector cache state or write out dirty sectors.",cacheCmd},
+                         {"cachestat","[reset]\r\n\t""Print sector cache statistics.",cachestatCmd},
+                         {"wcstat","[reset]\r\n\t""Print write coalescing statistics.",wcstatCmd},
+                         {"readahead","[window|auto]\r\n\t""Get/set number of blocks read ahead, 1 disables read ahead. auto uses the card profile.",readaheadCmd},
+                         {"rastat","[reset]\r\n\t""Print read ahead statistics.",rastatCmd},
+                         {"sdq","[reset]\r\n\t""Print SD request queue statistics.",sdqCmd},
+                         {"iostat","[reset]\r\n\t""Print SD operation counts and latency.",iostatCmd},
+                         {"card","[probe]\r\n\t""Print the I/O settings chosen from the card registers. probe reads the CSD again.",cardCmd},
+                         {"spitune","[start [n=passes] [save]]|[clear]\r\n\t""Find the fastest SPI clock with no errors. destroys data in 4 blocks at start. save keeps the divider for reinit.",spituneCmd},
+                         {"cpu","[ms] [on|off]\r\n\t""Print CPU usage of each task over a window. on keeps printing in the background.",cpuCmd},
+                         {"bg","command [args]\r\n\t""Run a command as a background job.",bgCmd},
+                         {"jobs","\r\n\t""List background jobs.",jobsCmd},
+                         {"progress","\r\n\t""Show progress and throughput of the background job.",progressCmd},
+                         {"kill","\r\n\t""Stop the background job.",killCmd},
+                         {"tafreq","[Hz]\r\n\t""Get/set calibrated timer A frequency used for timing.",tafreqCmd},
                          //end of list
                          {NULL,NULL,NULL}};
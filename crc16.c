@@ -0,0 +1,14 @@
+#include "crc16.h"
+
+//CRC for each nibble value so only 32 bytes of table are needed
+static const unsigned short crc_nibble[16]={0x0000,0x1021,0x2042,0x3063,0x4084,0x50A5,0x60C6,0x70E7,
+                                            0x8108,0x9129,0xA14A,0xB16B,0xC18C,0xD1AD,0xE1CE,0xF1EF};
+
+//update CRC-16-CCITT (poly 0x1021) with len bytes of data
+unsigned short crc16(unsigned short crc,const unsigned char *dat,unsigned short len){
+  while(len--){
+    crc=(crc<<4)^crc_nibble[((crc>>12)^(*dat>>4))&0x0F];
+    crc=(crc<<4)^crc_nibble[((crc>>12)^(*dat++))&0x0F];
+  }
+  return crc;
+}
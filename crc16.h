@@ -0,0 +1,10 @@
+#ifndef __CRC16_H
+#define __CRC16_H
+
+//initial value for CRC calculations
+#define CRC16_INIT    0xFFFF
+
+//update CRC-16-CCITT (poly 0x1021) with len bytes of data
+unsigned short crc16(unsigned short crc,const unsigned char *dat,unsigned short len);
+
+#endif
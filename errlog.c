@@ -0,0 +1,554 @@
+#include <stdio.h>
+#include <string.h>
+#include <ctl_api.h>
+#include <ARCbus.h>
+#include <SDlib.h>
+#include "errlog.h"
+#include "crc16.h"
+#include "SDtask.h"
+#include "SDcache.h"
+
+//decode an error into text, in Error_decode.c
+char *err_decode(char buf[150], unsigned short source,int err, unsigned short argument);
+
+//events for the flush task
+enum{ERRLOG_EV_NEW=0x01,ERRLOG_EV_FLUSH=0x02,ERRLOG_EV_START=0x04,ERRLOG_EV_DONE=0x08,ERRLOG_EV_CLEAR=0x10};
+
+static CTL_EVENT_SET_t errlog_evt;
+
+//records waiting for the flush task, indexes run freely and wrap
+static ERRLOG_REC ring[ERRLOG_RING_LEN];
+static volatile unsigned short ring_head,ring_tail;
+
+//sector being filled
+static union{
+  ERRLOG_SECTOR s;
+  unsigned char raw[512];
+}sect;
+
+//position of the sector in the log and how many records are staged in the cache
+static unsigned long sect_idx;
+static unsigned short sect_saved;
+
+//records in the cache that are not on the card yet
+static unsigned short unflushed;
+
+//index entries for full sectors, written once the sectors are on the card
+#define ERRLOG_IDX_PEND   2
+static ERRLOG_IDX idx_pend[ERRLOG_IDX_PEND];
+static unsigned short idx_num;
+
+//set once the end of the log is found
+static volatile int started=0;
+
+//result of the last flush or clear asked for by errlog_sync or errlog_clear
+static volatile int flush_resp;
+
+static ERRLOG_STATS stats;
+
+//time in ms a record can wait in RAM before it is written
+unsigned short errlog_deadline=ERRLOG_DEADLINE_DEFAULT;
+
+//setup log, must be called before tasks are started
+void errlog_init(void){
+  ctl_events_init(&errlog_evt,0);
+  ring_head=ring_tail=0;
+  started=0;
+  memset(&stats,0,sizeof(stats));
+}
+
+//check a log sector header
+static int errlog_valid(const ERRLOG_HDR *h){
+  return h->magic==ERRLOG_MAGIC && h->count<=ERRLOG_PER_SECTOR;
+}
+
+//read a log sector into the sector buffer
+static int errlog_read(unsigned long idx){
+  return SD_read(ERRLOG_START+idx,1,sect.raw,SD_PRI_LOW);
+}
+
+//start an empty sector
+static void errlog_new_sector(unsigned long idx,unsigned long seq){
+  memset(sect.raw,0,sizeof(sect.raw));
+  sect.s.hdr.magic=ERRLOG_MAGIC;
+  sect.s.hdr.seq=seq;
+  sect_idx=idx;
+  sect_saved=0;
+}
+
+//find the end of the log on the card and start writing, call once the card is initialized
+int errlog_start(void){
+  unsigned long lo,hi,mid,seq0;
+  int resp;
+  if(started){
+    return MMC_SUCCESS;
+  }
+  if((resp=errlog_read(0))!=MMC_SUCCESS){
+    return resp;
+  }
+  if(!errlog_valid(&sect.s.hdr)){
+    //empty log
+    errlog_new_sector(0,0);
+  }else{
+    //sectors up to the end of the log have consecutive sequence numbers
+    //anything after is left from the last time around or was never written
+    seq0=sect.s.hdr.seq;
+    for(lo=0,hi=ERRLOG_SECTORS;hi-lo>1;){
+      mid=(lo+hi)/2;
+      if((resp=errlog_read(mid))!=MMC_SUCCESS){
+        return resp;
+      }
+      if(errlog_valid(&sect.s.hdr) && sect.s.hdr.seq==seq0+mid){
+        lo=mid;
+      }else{
+        hi=mid;
+      }
+    }
+    //load the last sector and keep filling it if there is room
+    if((resp=errlog_read(lo))!=MMC_SUCCESS){
+      return resp;
+    }
+    if(sect.s.hdr.count<ERRLOG_PER_SECTOR && sect.s.hdr.crc==crc16(CRC16_INIT,(unsigned char*)sect.s.rec,sect.s.hdr.count*sizeof(ERRLOG_REC))){
+      sect_idx=lo;
+      sect_saved=sect.s.hdr.count;
+    }else{
+      errlog_new_sector((lo+1)%ERRLOG_SECTORS,seq0+lo+1);
+    }
+  }
+  started=1;
+  ctl_events_set_clear(&errlog_evt,ERRLOG_EV_START,0);
+  return MMC_SUCCESS;
+}
+
+//stage a record, never waits for the card
+int errlog_report(unsigned char level,unsigned short source,int err,unsigned short argument){
+  ERRLOG_REC *r;
+  unsigned long t=get_ticker_time();
+  unsigned short depth;
+  int en;
+  en=ctl_global_interrupts_set(0);
+  stats.reported++;
+  depth=ring_head-ring_tail;
+  if(depth>=ERRLOG_RING_LEN){
+    stats.dropped++;
+    ctl_global_interrupts_set(en);
+    return 1;
+  }
+  r=&ring[ring_head%ERRLOG_RING_LEN];
+  r->time=t;
+  r->level=level;
+  r->reserved=0;
+  r->source=source;
+  r->err=err;
+  r->argument=argument;
+  ring_head++;
+  if(depth+1>stats.max_depth){
+    stats.max_depth=depth+1;
+  }
+  ctl_global_interrupts_set(en);
+  //wake flush task
+  ctl_events_set_clear(&errlog_evt,ERRLOG_EV_NEW,0);
+  return 0;
+}
+
+//index bits for a record
+#define ERRLOG_LEVEL_BIT(l)     (1<<(((l)>7)?7:(l)))
+#define ERRLOG_SOURCE_BIT(s)    (1<<((s)%8))
+
+//summarize the full sector in the buffer for the index
+static void errlog_index_entry(ERRLOG_IDX *e){
+  unsigned short i;
+  e->first=sect.s.rec[0].time;
+  e->seq=sect.s.hdr.seq;
+  e->levels=0;
+  e->sources=0;
+  for(i=0;i<sect.s.hdr.count;i++){
+    e->levels|=ERRLOG_LEVEL_BIT(sect.s.rec[i].level);
+    e->sources|=ERRLOG_SOURCE_BIT(sect.s.rec[i].source);
+  }
+}
+
+//write staged sectors to the card and then add full sectors to the index
+//consecutive log sectors in the cache go out as one multi block write
+static int errlog_commit(void){
+  unsigned long addr;
+  unsigned short i,seq;
+  int resp;
+  if((resp=cache_flush())!=MMC_SUCCESS){
+    stats.errors++;
+    return resp;
+  }
+  stats.written+=unflushed;
+  unflushed=0;
+  if(idx_num==0){
+    return MMC_SUCCESS;
+  }
+  for(i=0;i<idx_num;i++){
+    //entries for the same index sector are changed in one cache line
+    seq=idx_pend[i].seq;
+    addr=ERRLOG_INDEX_START+(seq%ERRLOG_SECTORS)/ERRLOG_IDX_PER_SECTOR;
+    if(cache_update(addr,((seq%ERRLOG_SECTORS)%ERRLOG_IDX_PER_SECTOR)*sizeof(ERRLOG_IDX),&idx_pend[i],sizeof(ERRLOG_IDX))!=MMC_SUCCESS){
+      stats.index_errors++;
+    }else{
+      stats.indexed++;
+    }
+  }
+  idx_num=0;
+  //a lost index entry only makes replay read the sector so errors here are not passed on
+  if(cache_flush()!=MMC_SUCCESS){
+    stats.index_errors++;
+  }
+  return MMC_SUCCESS;
+}
+
+//stage the sector buffer in the cache, count is the reason for the write
+//full sectors are held until the next one is staged so both can be written together
+static int errlog_write(unsigned long *count){
+  unsigned long addr=ERRLOG_START+sect_idx,seq;
+  int resp;
+  sect.s.hdr.crc=crc16(CRC16_INIT,(unsigned char*)sect.s.rec,sect.s.hdr.count*sizeof(ERRLOG_REC));
+  if((resp=cache_writeBlock(addr,sect.raw))!=MMC_SUCCESS){
+    stats.errors++;
+    return resp;
+  }
+  (*count)++;
+  unflushed+=sect.s.hdr.count-sect_saved;
+  sect_saved=sect.s.hdr.count;
+  if(sect.s.hdr.count<ERRLOG_PER_SECTOR){
+    //partly filled sectors are only written when they are due so send it now
+    return errlog_commit();
+  }
+  //room is needed for the index entry, the sector stays current until there is
+  if(idx_num>=ERRLOG_IDX_PEND && (resp=errlog_commit())!=MMC_SUCCESS){
+    return resp;
+  }
+  //move on to the next sector
+  seq=sect.s.hdr.seq;
+  errlog_index_entry(&idx_pend[idx_num++]);
+  errlog_new_sector((sect_idx+1)%ERRLOG_SECTORS,seq+1);
+  if(idx_num==ERRLOG_IDX_PEND){
+    return errlog_commit();
+  }
+  return MMC_SUCCESS;
+}
+
+//write everything that is waiting, count is the reason for the write
+static int errlog_due(unsigned long *count){
+  //a full sector is still current if its index entry could not be queued
+  if(sect.s.hdr.count>sect_saved || sect.s.hdr.count==ERRLOG_PER_SECTOR){
+    return errlog_write(count);
+  }
+  //only full sectors are waiting in the cache
+  (*count)++;
+  return errlog_commit();
+}
+
+//write all staged records to the card and wait for it to finish
+//records stay staged if they could not be written
+int errlog_sync(void){
+  unsigned int e;
+  if(!started){
+    return MMC_INIT_ERROR;
+  }
+  ctl_events_set_clear(&errlog_evt,ERRLOG_EV_FLUSH,ERRLOG_EV_DONE);
+  //wait up to 2 seconds
+  e=ctl_events_wait(CTL_EVENT_WAIT_ANY_EVENTS_WITH_AUTO_CLEAR,&errlog_evt,ERRLOG_EV_DONE,CTL_TIMEOUT_DELAY,2048);
+  return (e&ERRLOG_EV_DONE)?flush_resp:MMC_TIMEOUT_ERROR;
+}
+
+//start the log over, called from the flush task
+//old sectors stay on the card but are never shown again
+static int errlog_reset(void){
+  ERRLOG_IDX *e=(ERRLOG_IDX*)sect.raw;
+  unsigned long seq,i;
+  unsigned short k;
+  int en,resp=MMC_SUCCESS;
+  //drop records that are waiting
+  en=ctl_global_interrupts_set(0);
+  ring_tail=ring_head;
+  ctl_global_interrupts_set(en);
+  idx_num=0;
+  unflushed=0;
+  cache_invalidate(ERRLOG_START,ERRLOG_END);
+  //jump the sequence number past every sector replay could look for
+  //so old sectors never match and are never taken as part of the log
+  seq=(sect.s.hdr.seq/ERRLOG_SECTORS+2)*ERRLOG_SECTORS;
+  //index entries with no levels set make replay skip the sectors before the new start without reading them
+  for(i=0;i<ERRLOG_INDEX_SECTORS && resp==MMC_SUCCESS;i++){
+    memset(sect.raw,0,sizeof(sect.raw));
+    for(k=0;k<ERRLOG_IDX_PER_SECTOR;k++){
+      e[k].seq=seq-ERRLOG_SECTORS+i*ERRLOG_IDX_PER_SECTOR+k;
+    }
+    resp=SD_write(ERRLOG_INDEX_START+i,1,sect.raw,SD_PRI_LOW);
+  }
+  //the log starts again at the first sector, an empty sector there marks the start
+  errlog_new_sector(0,seq);
+  sect.s.hdr.crc=crc16(CRC16_INIT,(unsigned char*)sect.s.rec,0);
+  if(resp==MMC_SUCCESS){
+    resp=SD_write(ERRLOG_START,1,sect.raw,SD_PRI_LOW);
+  }
+  return resp;
+}
+
+//throw away all records in RAM and on the card and start the log over
+int errlog_clear(void){
+  unsigned int e;
+  if(!started){
+    return MMC_INIT_ERROR;
+  }
+  ctl_events_set_clear(&errlog_evt,ERRLOG_EV_CLEAR,ERRLOG_EV_DONE);
+  //the index is rewritten so allow more time then a flush
+  e=ctl_events_wait(CTL_EVENT_WAIT_ANY_EVENTS_WITH_AUTO_CLEAR,&errlog_evt,ERRLOG_EV_DONE,CTL_TIMEOUT_DELAY,10240);
+  return (e&ERRLOG_EV_DONE)?flush_resp:MMC_TIMEOUT_ERROR;
+}
+
+//sector that the next records will be written to
+unsigned long errlog_position(void){
+  return ERRLOG_START+sect_idx;
+}
+
+//return nonzero if sectors start to end overlap the log or its index
+int errlog_overlaps(unsigned long start,unsigned long end){
+  return start<=ERRLOG_END && end>=ERRLOG_START;
+}
+
+//clear a filter so it matches everything
+void errlog_filter_init(ERRLOG_FILTER *f){
+  f->level=0;
+  f->source=0;
+  f->any_source=1;
+  f->from=0;
+  f->to=0xFFFFFFFF;
+  f->last=0;
+}
+
+//check a record against a filter
+static int errlog_match(const ERRLOG_FILTER *f,const ERRLOG_REC *r){
+  return r->level>=f->level && (f->any_source || r->source==f->source) && r->time>=f->from && r->time<=f->to;
+}
+
+//state for a replay
+typedef struct{
+  const ERRLOG_FILTER *f;
+  //index sector and log sector buffers
+  unsigned char *idx_buf,*log_buf;
+  //index sector in idx_buf
+  unsigned long idx_addr;
+  //first and last sequence numbers in the log
+  unsigned long oldest,newest;
+}ERRLOG_REPLAY;
+
+//check the index to see if a log sector can have matching records
+//sectors without a good index entry are always read
+static int errlog_may_match(ERRLOG_REPLAY *r,unsigned long seq){
+  const ERRLOG_IDX *e,*next;
+  unsigned long addr;
+  unsigned short i;
+  unsigned char lmask;
+  //newest sector is never in the index
+  if(seq==r->newest){
+    return 1;
+  }
+  addr=ERRLOG_INDEX_START+(seq%ERRLOG_SECTORS)/ERRLOG_IDX_PER_SECTOR;
+  if(addr!=r->idx_addr){
+    if(SD_read(addr,1,r->idx_buf,SD_PRI_LOW)!=MMC_SUCCESS){
+      r->idx_addr=0;
+      return 1;
+    }
+    r->idx_addr=addr;
+    stats.replay_index++;
+  }
+  i=(seq%ERRLOG_SECTORS)%ERRLOG_IDX_PER_SECTOR;
+  e=&((const ERRLOG_IDX*)r->idx_buf)[i];
+  if(e->seq!=(unsigned short)seq){
+    return 1;
+  }
+  //levels at or above the filter level
+  lmask=~(ERRLOG_LEVEL_BIT(r->f->level)-1);
+  if(!(e->levels&lmask)){
+    return 0;
+  }
+  if(!r->f->any_source && !(e->sources&ERRLOG_SOURCE_BIT(r->f->source))){
+    return 0;
+  }
+  if(e->first>r->f->to){
+    return 0;
+  }
+  //records end before the next sector starts
+  if((unsigned long)i+1<ERRLOG_IDX_PER_SECTOR && seq+1!=r->newest){
+    next=e+1;
+    if(next->seq==(unsigned short)(seq+1) && next->first<r->f->from){
+      return 0;
+    }
+  }
+  return 1;
+}
+
+//read a log sector, returns the number of records or -1 on error
+static int errlog_load(ERRLOG_REPLAY *r,unsigned long seq){
+  const ERRLOG_SECTOR *s=(const ERRLOG_SECTOR*)r->log_buf;
+  if(SD_read(ERRLOG_START+seq%ERRLOG_SECTORS,1,r->log_buf,SD_PRI_LOW)!=MMC_SUCCESS){
+    return -1;
+  }
+  stats.replay_log++;
+  if(!errlog_valid(&s->hdr) || s->hdr.seq!=seq){
+    return 0;
+  }
+  return s->hdr.count;
+}
+
+//print matching records of a sector, skip is the number of matches to leave out
+static unsigned long errlog_print(ERRLOG_REPLAY *r,unsigned long seq,unsigned long skip){
+  const ERRLOG_SECTOR *s=(const ERRLOG_SECTOR*)r->log_buf;
+  char buf[150];
+  unsigned long n=0;
+  int i,count;
+  if(!errlog_may_match(r,seq) || (count=errlog_load(r,seq))<=0){
+    return 0;
+  }
+  for(i=0;i<count;i++){
+    if(!errlog_match(r->f,&s->rec[i])){
+      continue;
+    }
+    if(skip){
+      skip--;
+      continue;
+    }
+    printf("%10lu %u %s\r\n",s->rec[i].time,s->rec[i].level,err_decode(buf,s->rec[i].source,s->rec[i].err,s->rec[i].argument));
+    n++;
+  }
+  return n;
+}
+
+//count matching records of a sector
+static unsigned long errlog_count(ERRLOG_REPLAY *r,unsigned long seq){
+  const ERRLOG_SECTOR *s=(const ERRLOG_SECTOR*)r->log_buf;
+  unsigned long n=0;
+  int i,count;
+  if(!errlog_may_match(r,seq) || (count=errlog_load(r,seq))<=0){
+    return 0;
+  }
+  for(i=0;i<count;i++){
+    if(errlog_match(r->f,&s->rec[i])){
+      n++;
+    }
+  }
+  return n;
+}
+
+//print records that match a filter
+int errlog_replay(const ERRLOG_FILTER *f,unsigned char *buf){
+  ERRLOG_REPLAY r;
+  unsigned long seq,n,skip=0,shown=0;
+  int resp;
+  //get everything onto the card first
+  if((resp=errlog_sync())!=MMC_SUCCESS){
+    return resp;
+  }
+  r.f=f;
+  r.idx_buf=buf;
+  r.log_buf=buf+512;
+  r.idx_addr=0;
+  r.newest=sect.s.hdr.seq;
+  r.oldest=(r.newest>=ERRLOG_SECTORS)?r.newest-(ERRLOG_SECTORS-1):0;
+  //the newest sector is the one being filled, skip it if it is empty
+  if(sect.s.hdr.count==0){
+    if(r.newest==0){
+      return MMC_SUCCESS;
+    }
+    r.newest--;
+  }
+  stats.replay_index=0;
+  stats.replay_log=0;
+  seq=r.oldest;
+  if(f->last){
+    //walk back from the end until enough records are found
+    for(seq=r.newest,n=0;;seq--){
+      n+=errlog_count(&r,seq);
+      if(n>=f->last || seq==r.oldest){
+        break;
+      }
+    }
+    //leave out extra records in the first sector
+    if(n>f->last){
+      skip=n-f->last;
+    }
+  }
+  for(;seq<=r.newest;seq++){
+    shown+=errlog_print(&r,seq,skip);
+    skip=0;
+  }
+  printf("%lu errors shown, %lu index and %lu log sectors read\r\n",shown,stats.replay_index,stats.replay_log);
+  return MMC_SUCCESS;
+}
+
+//get log statistics
+void errlog_get_stats(ERRLOG_STATS *s){
+  int en;
+  en=ctl_global_interrupts_set(0);
+  *s=stats;
+  ctl_global_interrupts_set(en);
+}
+
+//clear log statistics
+void errlog_clear_stats(void){
+  int en;
+  en=ctl_global_interrupts_set(0);
+  memset(&stats,0,sizeof(stats));
+  ctl_global_interrupts_set(en);
+}
+
+//task that writes staged records to the card
+//records are collected into whole sectors, a partly filled sector is
+//written when the oldest unwritten record reaches the deadline
+void errlog_task(void *p) __toplevel{
+  CTL_TIME_t due=0;
+  unsigned int e;
+  int resp;
+  //wait for the end of the log to be found
+  ctl_events_wait(CTL_EVENT_WAIT_ANY_EVENTS,&errlog_evt,ERRLOG_EV_START,CTL_TIMEOUT_NONE,0);
+  for(;;){
+    if(sect.s.hdr.count>sect_saved || unflushed){
+      e=ctl_events_wait(CTL_EVENT_WAIT_ANY_EVENTS_WITH_AUTO_CLEAR,&errlog_evt,ERRLOG_EV_NEW|ERRLOG_EV_FLUSH|ERRLOG_EV_CLEAR,CTL_TIMEOUT_ABSOLUTE,due);
+    }else{
+      e=ctl_events_wait(CTL_EVENT_WAIT_ANY_EVENTS_WITH_AUTO_CLEAR,&errlog_evt,ERRLOG_EV_NEW|ERRLOG_EV_FLUSH|ERRLOG_EV_CLEAR,CTL_TIMEOUT_NONE,0);
+    }
+    if(e&ERRLOG_EV_CLEAR){
+      flush_resp=errlog_reset();
+      ctl_events_set_clear(&errlog_evt,ERRLOG_EV_DONE,0);
+      continue;
+    }
+    do{
+      resp=MMC_SUCCESS;
+      //move staged records into the sector
+      while(ring_head!=ring_tail && sect.s.hdr.count<ERRLOG_PER_SECTOR){
+        if(sect.s.hdr.count==sect_saved && !unflushed){
+          //deadline starts with the first unwritten record
+          due=ctl_get_current_time()+((unsigned long)errlog_deadline*1024)/1000;
+        }
+        sect.s.rec[sect.s.hdr.count++]=ring[ring_tail%ERRLOG_RING_LEN];
+        ring_tail++;
+        if(sect.s.hdr.count==ERRLOG_PER_SECTOR && (resp=errlog_write(&stats.full))!=MMC_SUCCESS){
+          //try again at the deadline
+          break;
+        }
+      }
+      if(sect.s.hdr.count>sect_saved || unflushed){
+        if(e&ERRLOG_EV_FLUSH){
+          resp=errlog_due(&stats.forced);
+        }else if((long)(ctl_get_current_time()-due)>=0){
+          if((resp=errlog_due(&stats.deadline))!=MMC_SUCCESS){
+            //try again later
+            due=ctl_get_current_time()+((unsigned long)errlog_deadline*1024)/1000;
+          }
+        }
+      }
+    //a flush keeps going until the ring is empty or a write fails
+    }while((e&ERRLOG_EV_FLUSH) && resp==MMC_SUCCESS && ring_head!=ring_tail);
+    if(e&ERRLOG_EV_FLUSH){
+      //records that were not written stay staged for the next try
+      flush_resp=resp;
+      ctl_events_set_clear(&errlog_evt,ERRLOG_EV_DONE,0);
+    }
+  }
+}
@@ -0,0 +1,144 @@
+#ifndef __ERRLOG_H
+#define __ERRLOG_H
+
+//sectors used for the log on the card, the log wraps around
+#define ERRLOG_START      65536UL
+#define ERRLOG_SECTORS    4096UL
+
+//index of log sectors, one entry for each log sector
+#define ERRLOG_INDEX_START  (ERRLOG_START+ERRLOG_SECTORS)
+#define ERRLOG_IDX_PER_SECTOR   (512/sizeof(ERRLOG_IDX))
+#define ERRLOG_INDEX_SECTORS    ((ERRLOG_SECTORS+ERRLOG_IDX_PER_SECTOR-1)/ERRLOG_IDX_PER_SECTOR)
+
+//last sector of the log and index, sectors from ERRLOG_START to ERRLOG_END are
+//reserved and commands that write test data refuse ranges that overlap them
+#define ERRLOG_END        (ERRLOG_INDEX_START+ERRLOG_INDEX_SECTORS-1)
+
+//records staged in RAM waiting for the flush task
+#define ERRLOG_RING_LEN   32
+
+//default time in ms a record can wait in RAM before it is written
+#define ERRLOG_DEADLINE_DEFAULT   1000
+
+//marks a sector written by the log
+#define ERRLOG_MAGIC      0xE10C
+
+//one logged error
+typedef struct{
+  unsigned long time;
+  unsigned char level,reserved;
+  unsigned short source;
+  int err;
+  unsigned short argument;
+}ERRLOG_REC;
+
+//header at the start of each log sector
+typedef struct{
+  unsigned short magic;
+  //number of records in the sector
+  unsigned short count;
+  //sequence number, goes up by one for each sector in the log
+  unsigned long seq;
+  //CRC of the records
+  unsigned short crc;
+  unsigned short reserved;
+}ERRLOG_HDR;
+
+//number of records that fit in a sector after the header
+#define ERRLOG_PER_SECTOR   ((512-sizeof(ERRLOG_HDR))/sizeof(ERRLOG_REC))
+
+//layout of a log sector
+typedef struct{
+  ERRLOG_HDR hdr;
+  ERRLOG_REC rec[ERRLOG_PER_SECTOR];
+}ERRLOG_SECTOR;
+
+//index entry, summary of a full log sector
+typedef struct{
+  //time of the first record
+  unsigned long first;
+  //low bits of the sector sequence number, entries that don't match are stale
+  unsigned short seq;
+  //bit set for each level in the sector, levels above 7 use bit 7
+  unsigned char levels;
+  //bit set for source%8 of each record in the sector
+  unsigned char sources;
+}ERRLOG_IDX;
+
+//replay filter
+typedef struct{
+  //lowest level to show
+  unsigned char level;
+  //source to show, all sources if any_source is set
+  unsigned short source;
+  unsigned char any_source;
+  //time range to show
+  unsigned long from,to;
+  //show only the last records that match, zero shows all
+  unsigned long last;
+}ERRLOG_FILTER;
+
+//log statistics
+typedef struct{
+  //records passed to errlog_report
+  unsigned long reported;
+  //records lost because the ring was full
+  unsigned long dropped;
+  //records written to the card
+  unsigned long written;
+  //sector writes because the sector was full, the deadline passed or a flush was asked for
+  unsigned long full,deadline,forced;
+  //sector write errors
+  unsigned long errors;
+  //index updates and index write errors
+  unsigned long indexed,index_errors;
+  //sectors read by the last replay
+  unsigned long replay_index,replay_log;
+  //most records waiting in the ring
+  unsigned short max_depth;
+}ERRLOG_STATS;
+
+//time in ms a record can wait in RAM before it is written
+extern unsigned short errlog_deadline;
+
+//setup log, must be called before tasks are started
+void errlog_init(void);
+
+//find the end of the log on the card and start writing, call once the card is initialized
+int errlog_start(void);
+
+//stage a record, never waits for the card
+//returns nonzero if the record was dropped
+int errlog_report(unsigned char level,unsigned short source,int err,unsigned short argument);
+
+//write all staged records to the card and wait for it to finish
+//returns the SDlib error if a write failed, the records stay staged and are tried again
+int errlog_sync(void);
+
+//throw away all records in RAM and on the card and start the log over
+//returns the SDlib error if the index or first sector could not be written
+int errlog_clear(void);
+
+//sector that the next records will be written to
+unsigned long errlog_position(void);
+
+//return nonzero if sectors start to end overlap the log or its index
+int errlog_overlaps(unsigned long start,unsigned long end);
+
+//clear a filter so it matches everything
+void errlog_filter_init(ERRLOG_FILTER *f);
+
+//print records that match a filter, buf must have room for 2 sectors
+//sectors that can't match are skipped using the index
+int errlog_replay(const ERRLOG_FILTER *f,unsigned char *buf);
+
+//get log statistics
+void errlog_get_stats(ERRLOG_STATS *s);
+
+//clear log statistics
+void errlog_clear_stats(void);
+
+//task that writes staged records to the card
+void errlog_task(void *p);
+
+#endif
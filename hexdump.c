@@ -0,0 +1,59 @@
+#include <ARCbus.h>
+#include "hexdump.h"
+
+//bytes printed on each line
+#define HEX_LINE_BYTES    16
+
+//lookup table for hex digits
+static const char hex_digits[16]={'0','1','2','3','4','5','6','7','8','9','A','B','C','D','E','F'};
+
+//send a block of characters to the terminal
+void term_write(const char *buf,unsigned short len){
+  //whole block is queued with one call instead of one call per character
+  async_TxBuffer((const unsigned char*)buf,len);
+}
+
+//print data 16 bytes per line in hex
+void hex_dump(const unsigned char *dat,unsigned short len,unsigned long offset,unsigned short flags){
+  //offset, hex, ascii column and line ending
+  char line[10+3*HEX_LINE_BYTES+2+HEX_LINE_BYTES+1+2],*ptr;
+  unsigned short i,n;
+  int s;
+  while(len){
+    n=(len<HEX_LINE_BYTES)?len:HEX_LINE_BYTES;
+    ptr=line;
+    if(flags&HEX_OFFSET){
+      for(s=28;s>=0;s-=4){
+        *ptr++=hex_digits[(offset>>s)&0x0F];
+      }
+      *ptr++=':';
+      *ptr++=' ';
+    }
+    for(i=0;i<n;i++){
+      *ptr++=hex_digits[dat[i]>>4];
+      *ptr++=hex_digits[dat[i]&0x0F];
+      *ptr++=' ';
+    }
+    if(flags&HEX_ASCII){
+      //pad short lines so the columns line up
+      for(;i<HEX_LINE_BYTES;i++){
+        *ptr++=' ';
+        *ptr++=' ';
+        *ptr++=' ';
+      }
+      *ptr++=' ';
+      *ptr++='|';
+      for(i=0;i<n;i++){
+        //only print printable ASCII
+        *ptr++=(dat[i]>=' ' && dat[i]<0x7F)?dat[i]:'.';
+      }
+      *ptr++='|';
+    }
+    *ptr++='\r';
+    *ptr++='\n';
+    term_write(line,ptr-line);
+    dat+=n;
+    offset+=n;
+    len-=n;
+  }
+}
@@ -0,0 +1,16 @@
+#ifndef __HEXDUMP_H
+#define __HEXDUMP_H
+
+//flags for hex_dump
+enum{HEX_ASCII=1<<0,HEX_OFFSET=1<<1};
+
+//send a block of characters to the terminal
+void term_write(const char *buf,unsigned short len);
+
+//print data 16 bytes per line in hex
+//offset is the address printed for the first byte if HEX_OFFSET is set
+//sector dumps pass the offset in the sector, byte addresses overflow on cards over 4GB
+//HEX_ASCII adds a column with printable characters
+void hex_dump(const unsigned char *dat,unsigned short len,unsigned long offset,unsigned short flags);
+
+#endif
@@ -0,0 +1,429 @@
+//Host side emulation of the SDlib API
+//sectors are stored in an image file and every command is charged
+//time according to a simple latency model so that throughput can
+//be measured without hardware
+//settings are read from the environment when the card is first used
+//  SDEMU_IMAGE     image file, default sdcard.img
+//  SDEMU_BLOCKS    card size in blocks
+//  SDEMU_REALTIME  nonzero to wait out the modeled latency
+//  SDEMU_DMA       0 to start with DMA transfers off
+#define _FILE_OFFSET_BITS 64
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <ctl_api.h>
+#include <SDlib.h>
+#include "SDemu.h"
+
+#define SDEMU_BLOCK_SIZE      512
+
+//default image location and size if SDemu_open is not called
+#define SDEMU_DEFAULT_IMAGE   "sdcard.img"
+//default to a 2GB card
+#define SDEMU_DEFAULT_BLOCKS  (4096UL*1024UL)
+
+//value of erased bytes
+#define SDEMU_ERASE_VAL       0xFF
+
+const SDEMU_TIMING SDemu_default_timing={
+  //command overhead
+  50,
+  //4MHz SPI clock is 2us per byte
+  2000,
+  //read access time
+  300,
+  //program time per block
+  800,
+  //stop tran busy
+  500,
+  //erase times
+  2000,10
+};
+
+static int img_fd=-1;
+static unsigned long img_blocks;
+static int card_init=0;
+static int realtime=0;
+static int dma_en=1;
+static SDEMU_TIMING timing;
+static SDEMU_STATS stats;
+
+//charge time to the card
+static void charge(unsigned long long us){
+  stats.time_us+=us;
+  if(realtime && us){
+    struct timespec ts;
+    ts.tv_sec=us/1000000;
+    ts.tv_nsec=(us%1000000)*1000;
+    //with DMA other tasks run while the card is busy, without it the CPU spins
+    if(dma_en){
+      ctl_host_release();
+    }
+    nanosleep(&ts,NULL);
+    if(dma_en){
+      ctl_host_acquire();
+    }
+  }
+}
+
+//charge time for a command and count it
+static void charge_cmd(void){
+  stats.cmds++;
+  //6 byte command frame plus response byte
+  charge(timing.cmd_us+(7*timing.byte_ns)/1000);
+}
+
+//charge time for a data block transfer with token and CRC
+static void charge_block(void){
+  charge(((SDEMU_BLOCK_SIZE+3)*(unsigned long long)timing.byte_ns)/1000);
+}
+
+//parse environment and open the default image if needed
+static int emu_check_open(void){
+  const char *path,*str;
+  unsigned long blocks=SDEMU_DEFAULT_BLOCKS;
+  if(img_fd>=0){
+    return MMC_SUCCESS;
+  }
+  path=getenv("SDEMU_IMAGE");
+  if(path==NULL){
+    path=SDEMU_DEFAULT_IMAGE;
+  }
+  str=getenv("SDEMU_BLOCKS");
+  if(str!=NULL){
+    blocks=strtoul(str,NULL,0);
+  }
+  str=getenv("SDEMU_REALTIME");
+  if(str!=NULL){
+    realtime=atoi(str);
+  }
+  str=getenv("SDEMU_DMA");
+  if(str!=NULL){
+    dma_en=atoi(str);
+  }
+  return SDemu_open(path,blocks);
+}
+
+int SDemu_open(const char *path,unsigned long blocks){
+  off_t size;
+  SDemu_close();
+  if(blocks<1024){
+    return MMC_INVALID_CARD_SIZE;
+  }
+  img_fd=open(path,O_RDWR|O_CREAT,0644);
+  if(img_fd<0){
+    return MMC_INIT_ERROR;
+  }
+  size=(off_t)blocks*SDEMU_BLOCK_SIZE;
+  //extend the image if it is too small, this leaves a sparse file
+  if(lseek(img_fd,0,SEEK_END)<size && ftruncate(img_fd,size)){
+    close(img_fd);
+    img_fd=-1;
+    return MMC_INIT_ERROR;
+  }
+  //card size must be a multiple of 512KB for the CSD
+  img_blocks=blocks&~1023UL;
+  timing=SDemu_default_timing;
+  return MMC_SUCCESS;
+}
+
+void SDemu_close(void){
+  if(img_fd>=0){
+    close(img_fd);
+  }
+  img_fd=-1;
+  card_init=0;
+}
+
+void SDemu_set_timing(const SDEMU_TIMING *t){
+  timing=(t==NULL)?SDemu_default_timing:*t;
+}
+
+void SDemu_set_realtime(int rt){
+  realtime=rt;
+}
+
+void SDemu_set_DMA(int en){
+  dma_en=en;
+}
+
+void SDemu_get_stats(SDEMU_STATS *s){
+  *s=stats;
+}
+
+void SDemu_clear_stats(void){
+  memset(&stats,0,sizeof(stats));
+}
+
+unsigned long long SDemu_time_us(void){
+  return stats.time_us;
+}
+
+//check that the card is ready and the range is valid
+static int emu_check(SD_block_addr addr,unsigned long count){
+  if(!card_init){
+    return MMC_INIT_ERROR;
+  }
+  if(addr>=img_blocks || count>img_blocks-addr){
+    //card responds with address error
+    return MMC_RESPONSE_ERROR;
+  }
+  return MMC_SUCCESS;
+}
+
+//read a block from the image
+static int emu_read(SD_block_addr addr,unsigned char *buf){
+  if(pread(img_fd,buf,SDEMU_BLOCK_SIZE,(off_t)addr*SDEMU_BLOCK_SIZE)!=SDEMU_BLOCK_SIZE){
+    return MMC_DATA_TOKEN_ERROR;
+  }
+  stats.blocks_read++;
+  charge(timing.read_us);
+  charge_block();
+  return MMC_SUCCESS;
+}
+
+//write a block to the image
+static int emu_write(SD_block_addr addr,const unsigned char *buf){
+  static const unsigned char zero[SDEMU_BLOCK_SIZE];
+  //the target writes whatever is at address zero for a NULL pointer
+  //use zeros so that the data is at least repeatable
+  if(buf==NULL){
+    buf=zero;
+  }
+  if(pwrite(img_fd,buf,SDEMU_BLOCK_SIZE,(off_t)addr*SDEMU_BLOCK_SIZE)!=SDEMU_BLOCK_SIZE){
+    return MMC_WRITE_ERROR;
+  }
+  stats.blocks_written++;
+  charge_block();
+  charge(timing.program_us);
+  return MMC_SUCCESS;
+}
+
+void mmcInit_msp(void){
+  timing=SDemu_default_timing;
+  emu_check_open();
+}
+
+int mmcInit_card(void){
+  int resp;
+  resp=emu_check_open();
+  if(resp!=MMC_SUCCESS){
+    return resp;
+  }
+  //go idle, send op cond until ready, read OCR
+  charge_cmd();
+  charge_cmd();
+  charge_cmd();
+  charge(1000);
+  card_init=1;
+  return MMC_SUCCESS;
+}
+
+int mmcReInit_card(void){
+  card_init=0;
+  return mmcInit_card();
+}
+
+int mmc_is_init(void){
+  return card_init?MMC_SUCCESS:MMC_INIT_ERROR;
+}
+
+int SD_DMA_is_enabled(void){
+  return dma_en;
+}
+
+int mmcReadBlock(SD_block_addr addr,unsigned char *pBuffer){
+  int resp;
+  if((resp=emu_check(addr,1))!=MMC_SUCCESS){
+    return resp;
+  }
+  charge_cmd();
+  return emu_read(addr,pBuffer);
+}
+
+int mmcReadBlocks(SD_block_addr addr,unsigned short count,unsigned char *pBuffer){
+  int resp;
+  unsigned short i;
+  if((resp=emu_check(addr,count))!=MMC_SUCCESS){
+    return resp;
+  }
+  //READ_MULTIPLE_BLOCK
+  charge_cmd();
+  for(i=0;i<count;i++){
+    if((resp=emu_read(addr+i,pBuffer+i*SDEMU_BLOCK_SIZE))!=MMC_SUCCESS){
+      return resp;
+    }
+  }
+  //STOP_TRANSMISSION
+  charge_cmd();
+  return MMC_SUCCESS;
+}
+
+int mmcWriteBlock(SD_block_addr addr,const unsigned char *pBuffer){
+  int resp;
+  if((resp=emu_check(addr,1))!=MMC_SUCCESS){
+    return resp;
+  }
+  charge_cmd();
+  return emu_write(addr,pBuffer);
+}
+
+int mmcWriteMultiBlock(SD_block_addr addr,const unsigned char *pBuffer,unsigned short blocks){
+  int resp;
+  unsigned short i;
+  if((resp=emu_check(addr,blocks))!=MMC_SUCCESS){
+    return resp;
+  }
+  //WRITE_MULTIPLE_BLOCK
+  charge_cmd();
+  for(i=0;i<blocks;i++){
+    if((resp=emu_write(addr+i,pBuffer?pBuffer+i*SDEMU_BLOCK_SIZE:NULL))!=MMC_SUCCESS){
+      return resp;
+    }
+  }
+  //stop tran token and final busy
+  charge(timing.multi_stop_us);
+  return MMC_SUCCESS;
+}
+
+int mmcErase(SD_block_addr start,SD_block_addr end){
+  unsigned char buf[SDEMU_BLOCK_SIZE];
+  SD_block_addr i;
+  int resp;
+  if(end<start){
+    return MMC_BLOCK_SET_ERROR;
+  }
+  if((resp=emu_check(start,end-start+1))!=MMC_SUCCESS){
+    return resp;
+  }
+  memset(buf,SDEMU_ERASE_VAL,sizeof(buf));
+  for(i=start;i<=end;i++){
+    if(pwrite(img_fd,buf,SDEMU_BLOCK_SIZE,(off_t)i*SDEMU_BLOCK_SIZE)!=SDEMU_BLOCK_SIZE){
+      return MMC_WRITE_ERROR;
+    }
+  }
+  stats.blocks_erased+=end-start+1;
+  //ERASE_WR_BLK_START, ERASE_WR_BLK_END, ERASE
+  charge_cmd();
+  charge_cmd();
+  charge_cmd();
+  charge(timing.erase_us+(end-start+1)*(unsigned long long)timing.erase_block_us);
+  return MMC_SUCCESS;
+}
+
+//build a version 2.0 (SDHC) CSD for the emulated card
+static void emu_CSD(unsigned char *CSD){
+  unsigned long c_size=img_blocks/1024-1;
+  //CSD_STRUCTURE=1
+  CSD[0]=0x40;
+  //TAAC=1ms, NSAC=0
+  CSD[1]=0x0E;
+  CSD[2]=0x00;
+  //TRAN_SPEED=25MHz
+  CSD[3]=0x32;
+  //CCC=0x5B5, READ_BL_LEN=9
+  CSD[4]=0x5B;
+  CSD[5]=0x59;
+  CSD[6]=0x00;
+  //C_SIZE
+  CSD[7]=(c_size>>16)&0x3F;
+  CSD[8]=c_size>>8;
+  CSD[9]=c_size;
+  //ERASE_BLK_EN=1, SECTOR_SIZE=0x7F
+  CSD[10]=0x7F;
+  CSD[11]=0x80;
+  //R2W_FACTOR=2, WRITE_BL_LEN=9
+  CSD[12]=0x0A;
+  CSD[13]=0x40;
+  CSD[14]=0x00;
+  //CRC is not checked, end bit must be set
+  CSD[15]=0x01;
+}
+
+//build CID for the emulated card
+static void emu_CID(unsigned char *CID){
+  //manufacturer ID and OEM ID
+  CID[0]=0x03;
+  CID[1]='S';
+  CID[2]='D';
+  //product name
+  memcpy(CID+3,"SDEMU",5);
+  //product revision 1.0
+  CID[8]=0x10;
+  //serial number
+  CID[9]=0x12;
+  CID[10]=0x34;
+  CID[11]=0x56;
+  CID[12]=0x78;
+  //manufacturing date 2013-08
+  CID[13]=0x00;
+  CID[14]=0xD8;
+  CID[15]=0x01;
+}
+
+int mmcReadReg(unsigned char reg,unsigned char *buffer){
+  if(!card_init){
+    return MMC_INIT_ERROR;
+  }
+  charge_cmd();
+  //16 bytes plus token and CRC
+  charge((19*(unsigned long long)timing.byte_ns)/1000);
+  switch(reg){
+    case 0x40|9:
+      emu_CSD(buffer);
+    return MMC_SUCCESS;
+    case 0x40|10:
+      emu_CID(buffer);
+    return MMC_SUCCESS;
+    default:
+      return MMC_RESPONSE_ERROR;
+  }
+}
+
+//return card size in KB from the CSD
+unsigned long mmcGetCardSize(unsigned char *CSD){
+  unsigned long c_size;
+  unsigned short c_size_mult,read_bl_len;
+  if((CSD[0]>>6)==1){
+    //version 2.0 card
+    c_size=((unsigned long)(CSD[7]&0x3F)<<16)|((unsigned long)CSD[8]<<8)|CSD[9];
+    return (c_size+1)*512;
+  }
+  //version 1.0 card
+  read_bl_len=CSD[5]&0x0F;
+  c_size=((unsigned long)(CSD[6]&0x03)<<10)|((unsigned long)CSD[7]<<2)|(CSD[8]>>6);
+  c_size_mult=((CSD[9]&0x03)<<1)|(CSD[10]>>7);
+  return ((c_size+1)<<(c_size_mult+2+read_bl_len))/1024;
+}
+
+const char *SD_error_str(int error){
+  switch(error){
+    case MMC_SUCCESS:
+      return "MMC_SUCCESS";
+    case MMC_BLOCK_SET_ERROR:
+      return "MMC_BLOCK_SET_ERROR";
+    case MMC_RESPONSE_ERROR:
+      return "MMC_RESPONSE_ERROR";
+    case MMC_DATA_TOKEN_ERROR:
+      return "MMC_DATA_TOKEN_ERROR";
+    case MMC_INIT_ERROR:
+      return "MMC_INIT_ERROR";
+    case MMC_CRC_ERROR:
+      return "MMC_CRC_ERROR";
+    case MMC_WRITE_ERROR:
+      return "MMC_WRITE_ERROR";
+    case MMC_OTHER_ERROR:
+      return "MMC_OTHER_ERROR";
+    case MMC_TIMEOUT_ERROR:
+      return "MMC_TIMEOUT_ERROR";
+    case MMC_INVALID_CARD_SIZE:
+      return "MMC_INVALID_CARD_SIZE";
+    default:
+      return "Unknown Error";
+  }
+}
@@ -0,0 +1,64 @@
+#ifndef __SDEMU_H
+#define __SDEMU_H
+
+//Host side emulation of the SDlib API backed by an image file
+//link SDemu.c in place of SD-lib.hza to run commands.c on a build box
+
+//latency model, all times in microseconds except the per byte cost
+typedef struct{
+  //overhead for every command sent to the card
+  unsigned long cmd_us;
+  //SPI cost per byte transfered in nanoseconds
+  unsigned long byte_ns;
+  //time to read a block from flash before the data token
+  unsigned long read_us;
+  //program/busy time after each block is written
+  unsigned long program_us;
+  //extra busy time at the end of a multi block write
+  unsigned long multi_stop_us;
+  //fixed erase time and erase time per block
+  unsigned long erase_us;
+  unsigned long erase_block_us;
+}SDEMU_TIMING;
+
+//counters kept by the emulator
+typedef struct{
+  unsigned long cmds;
+  unsigned long blocks_read;
+  unsigned long blocks_written;
+  unsigned long blocks_erased;
+  //total modeled time in microseconds
+  unsigned long long time_us;
+}SDEMU_STATS;
+
+//default timing, roughly a class 4 card on a 4MHz SPI clock
+extern const SDEMU_TIMING SDemu_default_timing;
+
+//open card image, size is in blocks. image is created or extended if needed
+//timing is reset to SDemu_default_timing
+//returns MMC_SUCCESS on success
+int SDemu_open(const char *path,unsigned long blocks);
+
+//close card image
+void SDemu_close(void);
+
+//set latency model. passing NULL restores default timing
+void SDemu_set_timing(const SDEMU_TIMING *t);
+
+//if realtime is nonzero the modeled time is also spent sleeping
+//so that wall clock measurements see the card latency
+void SDemu_set_realtime(int realtime);
+
+//select modeled transfer mode for SD_DMA_is_enabled()
+void SDemu_set_DMA(int en);
+
+//get emulator counters
+void SDemu_get_stats(SDEMU_STATS *s);
+
+//clear emulator counters
+void SDemu_clear_stats(void);
+
+//get total modeled time in microseconds
+unsigned long long SDemu_time_us(void);
+
+#endif
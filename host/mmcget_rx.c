@@ -0,0 +1,150 @@
+//Host side receiver for the mmcget command
+//reads the byte stream from the async terminal connection (a tty or a
+//capture file), checks each frame and writes the sectors to an image
+//usage: mmcget_rx input image
+//a tty is put in raw mode so the binary frames are not changed by the line discipline
+//build: make mmcget_rx
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <termios.h>
+#include <unistd.h>
+#include "../crc16.h"
+#include "../xfer.h"
+
+//read one frame, returns frame type or -1 at end of input
+//bad frames return 0
+static int read_frame(FILE *in,unsigned short *seq,unsigned char *dat,unsigned short *len){
+  unsigned char hdr[XFER_HDR_LEN],crc[2];
+  int c,last=-1;
+  //find sync bytes, anything else is terminal text
+  for(;;){
+    if((c=fgetc(in))==EOF){
+      return -1;
+    }
+    if(last==XFER_SYNC0 && c==XFER_SYNC1){
+      break;
+    }
+    last=c;
+  }
+  if(fread(hdr,1,XFER_HDR_LEN,in)!=XFER_HDR_LEN){
+    return -1;
+  }
+  *seq=hdr[1]|(hdr[2]<<8);
+  *len=hdr[3]|(hdr[4]<<8);
+  if(*len>XFER_MAX_LEN){
+    return 0;
+  }
+  if(fread(dat,1,*len,in)!=*len || fread(crc,1,2,in)!=2){
+    return -1;
+  }
+  if(crc16(crc16(CRC16_INIT,hdr,XFER_HDR_LEN),dat,*len)!=(crc[0]|(crc[1]<<8))){
+    return 0;
+  }
+  return hdr[0];
+}
+
+//tty settings to put back at exit
+static struct termios tty_saved;
+static int tty_fd=-1;
+
+static void tty_restore(void){
+  if(tty_fd>=0){
+    tcsetattr(tty_fd,TCSANOW,&tty_saved);
+  }
+}
+
+//put a tty in raw mode, no echo and no CR/LF translation
+static int tty_raw(int fd){
+  struct termios t;
+  if(tcgetattr(fd,&tty_saved)){
+    return -1;
+  }
+  t=tty_saved;
+  cfmakeraw(&t);
+  if(tcsetattr(fd,TCSANOW,&t)){
+    return -1;
+  }
+  tty_fd=fd;
+  atexit(tty_restore);
+  return 0;
+}
+
+static double now(void){
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return ts.tv_sec+ts.tv_nsec/1e9;
+}
+
+int main(int argc,char **argv){
+  FILE *in,*out;
+  unsigned char dat[XFER_MAX_LEN];
+  unsigned short seq,len,last=0;
+  unsigned long base=0,sector,frames=0,bad=0,missing=0,expect=0,sent;
+  double tstart=0,tend;
+  int type;
+  if(argc!=3){
+    fprintf(stderr,"usage: %s input image\n",argv[0]);
+    return 1;
+  }
+  in=strcmp(argv[1],"-")?fopen(argv[1],"rb"):stdin;
+  if(in==NULL){
+    perror(argv[1]);
+    return 1;
+  }
+  if(isatty(fileno(in)) && tty_raw(fileno(in))){
+    perror("raw mode");
+    return 1;
+  }
+  out=fopen(argv[2],"wb");
+  if(out==NULL){
+    perror(argv[2]);
+    return 1;
+  }
+  while((type=read_frame(in,&seq,dat,&len))>=0){
+    if(frames==0 && bad==0){
+      tstart=now();
+    }
+    switch(type){
+      case XFER_DATA:
+        //sequence number is 16 bits, extend it
+        if(frames!=0 && seq<last && last-seq>0x8000){
+          base+=0x10000;
+        }
+        last=seq;
+        sector=base+seq;
+        if(sector>expect){
+          missing+=sector-expect;
+        }
+        expect=sector+1;
+        frames++;
+        fseek(out,(long)sector*XFER_MAX_LEN,SEEK_SET);
+        fwrite(dat,1,len,out);
+      break;
+      case XFER_ERR:
+        fprintf(stderr,"card error %u at sector %lu\n",dat[0]|(dat[1]<<8),
+                (unsigned long)dat[2]|((unsigned long)dat[3]<<8)|((unsigned long)dat[4]<<16)|((unsigned long)dat[5]<<24));
+      break;
+      case XFER_END:
+        tend=now();
+        sent=(unsigned long)dat[0]|((unsigned long)dat[1]<<8)|((unsigned long)dat[2]<<16)|((unsigned long)dat[3]<<24);
+        if(sent>expect){
+          missing+=sent-expect;
+        }
+        printf("%lu sectors received, %lu sent, %lu bad frames, %lu missing\n",frames,sent,bad,missing);
+        if(tend>tstart){
+          printf("%.1f KB/s\n",frames*XFER_MAX_LEN/1024.0/(tend-tstart));
+        }
+        fclose(out);
+        return (bad || missing)?2:0;
+      default:
+        bad++;
+      break;
+    }
+  }
+  fprintf(stderr,"input ended before end frame, %lu sectors received\n",frames);
+  fclose(out);
+  return 2;
+}
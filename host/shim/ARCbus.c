@@ -0,0 +1,107 @@
+//Host port of the ARCbus library calls used by this program
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctl_api.h>
+#include <ARCbus.h>
+#include <Error.h>
+
+CTL_EVENT_SET_t SUB_events;
+ARC_BUS_STAT arcBus_stat;
+unsigned char async_addr=BUS_ADDR_CDH;
+
+static CTL_TASK_t idle_task;
+
+static unsigned char bus_buffer[BUS_BUFFER_SIZE];
+//set while the buffer is in use
+static CTL_MUTEX_t buffer_mutex;
+
+void ARC_setup(void){
+  //main becomes the idle task
+  ctl_task_init(&idle_task,0,"idle");
+  ctl_events_init(&SUB_events,0);
+  ctl_mutex_init(&buffer_mutex);
+}
+
+void initARCbus(unsigned char addr){
+  //async connection is always open on the host
+  ctl_events_set_clear(&SUB_events,SUB_EV_ASYNC_OPEN,0);
+}
+
+void mainLoop(void){
+  //idle until the program exits
+  for(;;){
+    ctl_timeout_wait(ctl_get_current_time()+1024);
+  }
+}
+
+void *BUS_get_buffer(int timeout_type,CTL_TIME_t timeout){
+  if(!ctl_mutex_lock(&buffer_mutex,timeout_type,timeout)){
+    return NULL;
+  }
+  return bus_buffer;
+}
+
+void BUS_free_buffer(void){
+  ctl_mutex_unlock(&buffer_mutex);
+}
+
+void BUS_free_buffer_from_event(void){
+}
+
+unsigned short BUS_get_buffer_size(void){
+  return BUS_BUFFER_SIZE;
+}
+
+unsigned char *BUS_cmd_init(unsigned char *buf,unsigned char id){
+  buf[0]=id;
+  return buf+2;
+}
+
+int BUS_cmd_tx(unsigned char addr,void *buff,unsigned short len,unsigned short flags,int type){
+  return RET_SUCCESS;
+}
+
+int async_TxChar(unsigned char c){
+  return putchar(c);
+}
+
+//send a block of characters to stdout with one write
+int async_TxBuffer(const unsigned char *buf,unsigned short len){
+  return fwrite(buf,1,len,stdout)==len?0:-1;
+}
+
+//read a character from stdin, the program ends with the input
+int async_Getc(void){
+  int c;
+  fflush(stdout);
+  //let other tasks run while waiting for input
+  ctl_host_release();
+  c=getchar();
+  ctl_host_acquire();
+  if(c==EOF){
+    exit(0);
+  }
+  return c;
+}
+
+int async_isOpen(void){
+  return 1;
+}
+
+int async_close(void){
+  return RET_SUCCESS;
+}
+
+void async_setup_close_event(CTL_EVENT_SET_t *e,CTL_EVENT_SET_t flag){
+}
+
+long get_ticker_time(void){
+  return ctl_get_current_time()/1024;
+}
+
+void reset(unsigned char level,unsigned short source,int err,unsigned short argument){
+  report_error(level,source,err,argument);
+  printf("reset\r\n");
+  exit(0);
+}
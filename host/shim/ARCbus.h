@@ -0,0 +1,90 @@
+#ifndef __ARCBUS_H
+#define __ARCBUS_H
+
+//Host port of the parts of the ARCbus library used by this program
+//there is no bus, the async connection is stdin/stdout
+
+#include <ctl_api.h>
+
+//board addresses
+#define BUS_ADDR_LEDL     0x11
+#define BUS_ADDR_ACDS     0x12
+#define BUS_ADDR_COMM     0x13
+#define BUS_ADDR_IMG      0x14
+#define BUS_ADDR_CDH      0x15
+#define BUS_ADDR_GC       0x00
+
+//task priorities
+#define BUS_PRI_LOW       10
+#define BUS_PRI_NORMAL    50
+#define BUS_PRI_HIGH      100
+
+//return values
+#define RET_SUCCESS       0
+#define ERR_PK_LEN        -1
+#define ERR_UNKNOWN_CMD   -2
+
+//commands
+#define CMD_RESET         7
+
+//send flags
+#define BUS_I2C_SEND_FOREGROUND   0x01
+
+//subsystem events
+#define SUB_EV_PWR_OFF      0x0001
+#define SUB_EV_PWR_ON       0x0002
+#define SUB_EV_SEND_STAT    0x0004
+#define SUB_EV_TIME_CHECK   0x0008
+#define SUB_EV_SPI_DAT      0x0010
+#define SUB_EV_SPI_ERR_CRC  0x0020
+#define SUB_EV_ASYNC_OPEN   0x0040
+#define SUB_EV_ASYNC_CLOSE  0x0080
+#define SUB_EV_ALL          (SUB_EV_PWR_OFF|SUB_EV_PWR_ON|SUB_EV_SEND_STAT|SUB_EV_TIME_CHECK|SUB_EV_SPI_DAT|SUB_EV_SPI_ERR_CRC)
+
+//size of the shared bus buffer
+#define BUS_BUFFER_SIZE     2048
+
+extern CTL_EVENT_SET_t SUB_events;
+
+typedef struct{
+  struct{
+    unsigned short len;
+    unsigned char *rx;
+  }spi_stat;
+}ARC_BUS_STAT;
+
+extern ARC_BUS_STAT arcBus_stat;
+extern unsigned char async_addr;
+
+//subsystem command handler, supplied by the program
+int SUB_parseCmd(unsigned char src,unsigned char cmd,unsigned char *dat,unsigned short len);
+
+void ARC_setup(void);
+void initARCbus(unsigned char addr);
+void mainLoop(void);
+
+//bus buffer
+void *BUS_get_buffer(int timeout_type,CTL_TIME_t timeout);
+void BUS_free_buffer(void);
+void BUS_free_buffer_from_event(void);
+unsigned short BUS_get_buffer_size(void);
+
+//bus commands, nothing is sent on the host
+unsigned char *BUS_cmd_init(unsigned char *buf,unsigned char id);
+int BUS_cmd_tx(unsigned char addr,void *buff,unsigned short len,unsigned short flags,int type);
+
+//async connection
+int async_TxChar(unsigned char c);
+int async_TxBuffer(const unsigned char *buf,unsigned short len);
+int async_Getc(void);
+int async_isOpen(void);
+int async_close(void);
+void async_setup_close_event(CTL_EVENT_SET_t *e,CTL_EVENT_SET_t flag);
+
+//time in seconds
+long get_ticker_time(void);
+
+//log an error and restart, the host program exits
+void reset(unsigned char level,unsigned short source,int err,unsigned short argument);
+
+#endif
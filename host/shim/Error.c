@@ -0,0 +1,83 @@
+//Host port of the ErrorLib calls used by this program
+//errors are written to the emulated card one at a time so the cost of
+//reporting can be compared with the staged log in errlog.c
+#include <stdio.h>
+#include <string.h>
+#include <SDlib.h>
+#include <Error.h>
+
+//sectors used for saved errors
+#define ERR_HOST_START      32768UL
+#define ERR_HOST_SECTORS    1024UL
+
+//one saved error
+typedef struct{
+  unsigned long time;
+  unsigned char level;
+  unsigned short source;
+  int err;
+  unsigned short argument;
+}ERR_HOST_REC;
+
+#define ERR_HOST_PER_SECTOR   (512/sizeof(ERR_HOST_REC))
+
+//decode an error into text, in Error_decode.c
+char *err_decode(char buf[150],unsigned short source,int err,unsigned short argument);
+long get_ticker_time(void);
+
+static unsigned char err_level=ERR_LEV_DEBUG;
+static unsigned long err_count;
+static union{
+  ERR_HOST_REC rec[ERR_HOST_PER_SECTOR];
+  unsigned char raw[512];
+}sect;
+
+void report_error(unsigned char level,unsigned short source,int err,unsigned short argument){
+  ERR_HOST_REC *r;
+  if(level<err_level){
+    return;
+  }
+  r=&sect.rec[err_count%ERR_HOST_PER_SECTOR];
+  r->time=get_ticker_time();
+  r->level=level;
+  r->source=source;
+  r->err=err;
+  r->argument=argument;
+  //sector is written for every error
+  mmcWriteBlock(ERR_HOST_START+(err_count/ERR_HOST_PER_SECTOR)%ERR_HOST_SECTORS,sect.raw);
+  err_count++;
+  if(err_count%ERR_HOST_PER_SECTOR==0){
+    memset(sect.raw,0,sizeof(sect.raw));
+  }
+}
+
+void error_log_replay(void){
+  union{
+    ERR_HOST_REC rec[ERR_HOST_PER_SECTOR];
+    unsigned char raw[512];
+  }buf;
+  char str[150];
+  unsigned long i,first=0;
+  if(err_count>ERR_HOST_SECTORS*ERR_HOST_PER_SECTOR){
+    first=err_count-ERR_HOST_SECTORS*ERR_HOST_PER_SECTOR;
+  }
+  for(i=first;i<err_count;i++){
+    if(i==first || i%ERR_HOST_PER_SECTOR==0){
+      if(mmcReadBlock(ERR_HOST_START+(i/ERR_HOST_PER_SECTOR)%ERR_HOST_SECTORS,buf.raw)!=MMC_SUCCESS){
+        printf("Error reading saved errors\r\n");
+        return;
+      }
+    }
+    printf("%10lu %u %s\r\n",buf.rec[i%ERR_HOST_PER_SECTOR].time,buf.rec[i%ERR_HOST_PER_SECTOR].level,err_decode(str,buf.rec[i%ERR_HOST_PER_SECTOR].source,buf.rec[i%ERR_HOST_PER_SECTOR].err,buf.rec[i%ERR_HOST_PER_SECTOR].argument));
+  }
+}
+
+int clear_saved_errors(void){
+  err_count=0;
+  memset(sect.raw,0,sizeof(sect.raw));
+  return mmcErase(ERR_HOST_START,ERR_HOST_START+ERR_HOST_SECTORS-1);
+}
+
+void set_error_level(unsigned char level){
+  err_level=level;
+}
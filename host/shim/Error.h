@@ -0,0 +1,28 @@
+#ifndef __ERROR_H
+#define __ERROR_H
+
+//Host port of the ErrorLib calls used by this program
+
+//error levels
+#define ERR_LEV_DEBUG       0
+#define ERR_LEV_INFO        1
+#define ERR_LEV_WARNING     2
+#define ERR_LEV_ERROR       3
+#define ERR_LEV_CRITICAL    4
+
+//first error source for subsystem specific errors
+#define ERR_SRC_SUBSYSTEM   32
+
+//log an error, each error is written to the card right away like the SD card build of ErrorLib
+void report_error(unsigned char level,unsigned short source,int err,unsigned short argument);
+
+//print all saved errors
+void error_log_replay(void);
+
+//clear saved errors, returns SDlib error code
+int clear_saved_errors(void);
+
+//set lowest level that is saved
+void set_error_level(unsigned char level);
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef __SDLIB_H
+#define __SDLIB_H
+
+//SDlib API implemented by SDemu.c for the host build
+
+typedef unsigned long SD_block_addr;
+
+//return values
+enum{MMC_SUCCESS=0,MMC_BLOCK_SET_ERROR,MMC_RESPONSE_ERROR,MMC_DATA_TOKEN_ERROR,MMC_INIT_ERROR,MMC_CRC_ERROR,MMC_WRITE_ERROR,MMC_OTHER_ERROR,MMC_TIMEOUT_ERROR,MMC_INVALID_CARD_SIZE};
+
+void mmcInit_msp(void);
+int mmcInit_card(void);
+int mmcReInit_card(void);
+int mmc_is_init(void);
+int SD_DMA_is_enabled(void);
+int mmcReadBlock(SD_block_addr addr,unsigned char *pBuffer);
+int mmcReadBlocks(SD_block_addr addr,unsigned short count,unsigned char *pBuffer);
+int mmcWriteBlock(SD_block_addr addr,const unsigned char *pBuffer);
+int mmcWriteMultiBlock(SD_block_addr addr,const unsigned char *pBuffer,unsigned short blocks);
+int mmcErase(SD_block_addr start,SD_block_addr end);
+int mmcReadReg(unsigned char reg,unsigned char *buffer);
+unsigned long mmcGetCardSize(unsigned char *CSD);
+const char *SD_error_str(int error);
+
+#endif
@@ -0,0 +1,389 @@
+//Host port of the CrossWorks tasking library calls used by this program
+//only one task runs at a time, the running task holds the CPU lock and
+//every change that could wake a task is broadcast to all waiting tasks
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include "ctl_api.h"
+
+CTL_TASK_t *ctl_task_executing=NULL;
+CTL_TASK_t *ctl_task_list=NULL;
+CTL_TIME_t ctl_timeslice_period=0;
+
+static pthread_mutex_t cpu=PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wake=PTHREAD_COND_INITIALIZER;
+
+//task that the calling thread runs
+static __thread CTL_TASK_t *self;
+//interrupt enable for ctl_global_interrupts_set, all tasks share the CPU lock so it only has to be remembered
+static __thread int int_en=1;
+
+//time accounting, execution_time is in 1/1024 sec ticks but is counted in ns here
+static CTL_TASK_t *idle;
+static unsigned long long run_start,free_start;
+#define CTL_HOST_MAX_TASKS    16
+static struct{
+  CTL_TASK_t *task;
+  unsigned long long ns;
+}exec_ns[CTL_HOST_MAX_TASKS];
+
+//start time for ctl_get_current_time
+static unsigned long long ctl_epoch;
+
+//monotonic time in ns
+static unsigned long long now_ns(void){
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return ts.tv_sec*1000000000ULL+ts.tv_nsec;
+}
+
+//add run time to a task
+static void charge(CTL_TASK_t *t,unsigned long long ns){
+  int i;
+  if(t==NULL){
+    return;
+  }
+  for(i=0;i<CTL_HOST_MAX_TASKS;i++){
+    if(exec_ns[i].task==t || exec_ns[i].task==NULL){
+      exec_ns[i].task=t;
+      exec_ns[i].ns+=ns;
+      t->execution_time=(exec_ns[i].ns*1024)/1000000000ULL;
+      return;
+    }
+  }
+}
+
+//called with the lock held after the thread gets the CPU
+static void cpu_got(void){
+  unsigned long long t=now_ns();
+  //time with no task running belongs to the idle task
+  charge(idle,t-free_start);
+  run_start=t;
+  ctl_task_executing=self;
+  if(self){
+    self->state=CTL_STATE_RUNNABLE;
+  }
+}
+
+//called with the lock held before the thread gives up the CPU
+static void cpu_give(unsigned char state){
+  unsigned long long t=now_ns();
+  charge(self,t-run_start);
+  free_start=t;
+  if(self){
+    self->state=state;
+  }
+}
+
+//wait for something to change, returns nonzero on timeout
+//deadline is in ns, zero waits forever
+static int cpu_wait(unsigned char state,unsigned long long deadline){
+  struct timespec ts;
+  int ret=0;
+  cpu_give(state);
+  if(deadline==0){
+    pthread_cond_wait(&wake,&cpu);
+  }else{
+    //condition uses CLOCK_REALTIME, convert the deadline
+    clock_gettime(CLOCK_REALTIME,&ts);
+    deadline=ts.tv_sec*1000000000ULL+ts.tv_nsec+(deadline>now_ns()?deadline-now_ns():0);
+    ts.tv_sec=deadline/1000000000ULL;
+    ts.tv_nsec=deadline%1000000000ULL;
+    ret=pthread_cond_timedwait(&wake,&cpu,&ts)!=0;
+  }
+  cpu_got();
+  return ret;
+}
+
+//let other tasks run
+static void cpu_yield(void){
+  cpu_give(CTL_STATE_RUNNABLE);
+  pthread_mutex_unlock(&cpu);
+  sched_yield();
+  pthread_mutex_lock(&cpu);
+  cpu_got();
+}
+
+//tell waiting tasks that something changed
+static void cpu_changed(void){
+  pthread_cond_broadcast(&wake);
+}
+
+//give up the CPU lock around a blocking system call
+void ctl_host_release(void){
+  cpu_give(CTL_STATE_SUSPENDED);
+  pthread_mutex_unlock(&cpu);
+}
+
+void ctl_host_acquire(void){
+  pthread_mutex_lock(&cpu);
+  cpu_got();
+}
+
+//convert a CTL timeout to an absolute deadline in ns, zero for no timeout
+static unsigned long long ctl_deadline(int type,CTL_TIME_t t){
+  switch(type){
+    case CTL_TIMEOUT_ABSOLUTE:
+      return ctl_epoch+((unsigned long long)t*1000000000ULL)/1024;
+    case CTL_TIMEOUT_DELAY:
+      return now_ns()+((unsigned long long)t*1000000000ULL)/1024;
+    case CTL_TIMEOUT_NOW:
+      return 1;
+    default:
+      return 0;
+  }
+}
+
+//add a task to the list in priority order
+static void task_link(CTL_TASK_t *task){
+  CTL_TASK_t **p;
+  for(p=&ctl_task_list;*p!=NULL && (*p)->priority>=task->priority;p=&(*p)->next);
+  task->next=*p;
+  *p=task;
+}
+
+static void task_unlink(CTL_TASK_t *task){
+  CTL_TASK_t **p;
+  for(p=&ctl_task_list;*p!=NULL;p=&(*p)->next){
+    if(*p==task){
+      *p=task->next;
+      return;
+    }
+  }
+}
+
+static void task_setup(CTL_TASK_t *task,unsigned char priority,const char *name){
+  memset(task,0,sizeof(*task));
+  task->priority=priority;
+  task->name=name;
+  task_link(task);
+}
+
+//make the calling thread a task, the thread gets the CPU
+void ctl_task_init(CTL_TASK_t *task,unsigned char priority,const char *name){
+  ctl_epoch=now_ns();
+  task_setup(task,priority,name);
+  //the first task runs when nothing else can
+  idle=task;
+  self=task;
+  pthread_mutex_lock(&cpu);
+  free_start=now_ns();
+  cpu_got();
+}
+
+//arguments for a new thread
+typedef struct{
+  CTL_TASK_t *task;
+  void (*entry)(void *);
+  void *arg;
+}TASK_START;
+
+static void *task_thread(void *p){
+  TASK_START s=*(TASK_START*)p;
+  free(p);
+  self=s.task;
+  pthread_mutex_lock(&cpu);
+  cpu_got();
+  s.entry(s.arg);
+  //tasks are not supposed to return
+  task_unlink(s.task);
+  cpu_give(CTL_STATE_SUSPENDED);
+  pthread_mutex_unlock(&cpu);
+  return NULL;
+}
+
+void ctl_task_run(CTL_TASK_t *task,unsigned char priority,void (*entrypoint)(void *),void *parameter,const char *name,unsigned stack_size_in_words,unsigned *stack,unsigned call_size_in_words){
+  pthread_t th;
+  TASK_START *s;
+  task_setup(task,priority,name);
+  //host threads have their own stacks, keep the MSP430 stack for the stack command
+  task->stack_start=stack;
+  task->stack_pointer=stack+stack_size_in_words;
+  s=malloc(sizeof(*s));
+  if(s==NULL){
+    fprintf(stderr,"out of memory starting task %s\n",name);
+    exit(1);
+  }
+  s->task=task;
+  s->entry=entrypoint;
+  s->arg=parameter;
+  if(pthread_create(&th,NULL,task_thread,s)){
+    fprintf(stderr,"could not start task %s\n",name);
+    exit(1);
+  }
+  pthread_detach(th);
+}
+
+void ctl_task_remove(CTL_TASK_t *task){
+  //a thread can't be stopped safely, it just drops out of the list
+  task_unlink(task);
+  task->state=CTL_STATE_SUSPENDED;
+}
+
+unsigned char ctl_task_set_priority(CTL_TASK_t *task,unsigned char priority){
+  unsigned char old=task->priority;
+  task_unlink(task);
+  task->priority=priority;
+  task_link(task);
+  return old;
+}
+
+void ctl_task_reschedule(void){
+  cpu_yield();
+}
+
+int ctl_global_interrupts_set(int enable){
+  int old=int_en;
+  int_en=enable;
+  return old;
+}
+
+CTL_TIME_t ctl_get_current_time(void){
+  return ((now_ns()-ctl_epoch)*1024)/1000000000ULL;
+}
+
+void ctl_timeout_wait(CTL_TIME_t t){
+  unsigned long long deadline=ctl_deadline(CTL_TIMEOUT_ABSOLUTE,t);
+  while(now_ns()<deadline){
+    cpu_wait(CTL_STATE_TIMER_WAIT,deadline);
+  }
+}
+
+void ctl_events_init(CTL_EVENT_SET_t *e,CTL_EVENT_SET_t set){
+  *e=set;
+}
+
+void ctl_events_set_clear(CTL_EVENT_SET_t *e,CTL_EVENT_SET_t set,CTL_EVENT_SET_t clear){
+  *e=(*e|set)&~clear;
+  cpu_changed();
+}
+
+unsigned ctl_events_wait(int type,CTL_EVENT_SET_t *e,CTL_EVENT_SET_t events,int timeout_type,CTL_TIME_t timeout){
+  unsigned long long deadline=ctl_deadline(timeout_type,timeout);
+  int all=(type==CTL_EVENT_WAIT_ALL_EVENTS || type==CTL_EVENT_WAIT_ALL_EVENTS_WITH_AUTO_CLEAR);
+  int ac=(type==CTL_EVENT_WAIT_ANY_EVENTS_WITH_AUTO_CLEAR || type==CTL_EVENT_WAIT_ALL_EVENTS_WITH_AUTO_CLEAR);
+  unsigned got;
+  for(;;){
+    got=*e&events;
+    if(all?(got==events):(got!=0)){
+      if(ac){
+        *e&=~got;
+      }
+      return got;
+    }
+    if(deadline==1 || (deadline && now_ns()>=deadline)){
+      return 0;
+    }
+    cpu_wait(all?CTL_STATE_EVENT_WAIT_ALL:CTL_STATE_EVENT_WAIT_ANY,deadline);
+  }
+}
+
+//update the events for a queue
+static void queue_events(CTL_MESSAGE_QUEUE_t *q){
+  if(q->e==NULL){
+    return;
+  }
+  *q->e=(*q->e&~(q->notempty|q->notfull))|(q->n?q->notempty:0)|((q->n<q->s)?q->notfull:0);
+  cpu_changed();
+}
+
+void ctl_message_queue_init(CTL_MESSAGE_QUEUE_t *q,void **queue,unsigned queue_size){
+  q->q=queue;
+  q->s=queue_size;
+  q->front=0;
+  q->n=0;
+  q->e=NULL;
+}
+
+void ctl_message_queue_setup_events(CTL_MESSAGE_QUEUE_t *q,CTL_EVENT_SET_t *e,CTL_EVENT_SET_t notempty,CTL_EVENT_SET_t notfull){
+  q->e=e;
+  q->notempty=notempty;
+  q->notfull=notfull;
+  queue_events(q);
+}
+
+unsigned ctl_message_queue_post_nb(CTL_MESSAGE_QUEUE_t *q,void *message){
+  if(q->n>=q->s){
+    return 0;
+  }
+  q->q[(q->front+q->n++)%q->s]=message;
+  queue_events(q);
+  cpu_changed();
+  return 1;
+}
+
+unsigned ctl_message_queue_post(CTL_MESSAGE_QUEUE_t *q,void *message,int timeout_type,CTL_TIME_t timeout){
+  unsigned long long deadline=ctl_deadline(timeout_type,timeout);
+  while(!ctl_message_queue_post_nb(q,message)){
+    if(deadline==1 || (deadline && now_ns()>=deadline)){
+      return 0;
+    }
+    cpu_wait(CTL_STATE_MESSAGE_QUEUE_POST_WAIT,deadline);
+  }
+  return 1;
+}
+
+unsigned ctl_message_queue_receive_nb(CTL_MESSAGE_QUEUE_t *q,void **message){
+  if(q->n==0){
+    return 0;
+  }
+  *message=q->q[q->front];
+  q->front=(q->front+1)%q->s;
+  q->n--;
+  queue_events(q);
+  cpu_changed();
+  return 1;
+}
+
+unsigned ctl_message_queue_receive(CTL_MESSAGE_QUEUE_t *q,void **message,int timeout_type,CTL_TIME_t timeout){
+  unsigned long long deadline=ctl_deadline(timeout_type,timeout);
+  while(!ctl_message_queue_receive_nb(q,message)){
+    if(deadline==1 || (deadline && now_ns()>=deadline)){
+      return 0;
+    }
+    cpu_wait(CTL_STATE_MESSAGE_QUEUE_RECEIVE_WAIT,deadline);
+  }
+  return 1;
+}
+
+unsigned ctl_message_queue_num_used(CTL_MESSAGE_QUEUE_t *q){
+  return q->n;
+}
+
+unsigned ctl_message_queue_num_free(CTL_MESSAGE_QUEUE_t *q){
+  return q->s-q->n;
+}
+
+void ctl_mutex_init(CTL_MUTEX_t *m){
+  m->lock_count=0;
+  m->locking_task=NULL;
+  m->locking_task_priority=0;
+}
+
+//mutexes can be locked more then once by the same task
+unsigned ctl_mutex_lock(CTL_MUTEX_t *m,int timeout_type,CTL_TIME_t timeout){
+  unsigned long long deadline=ctl_deadline(timeout_type,timeout);
+  while(m->lock_count && m->locking_task!=self){
+    if(deadline==1 || (deadline && now_ns()>=deadline)){
+      return 0;
+    }
+    cpu_wait(CTL_STATE_MUTEX_WAIT,deadline);
+  }
+  m->lock_count++;
+  m->locking_task=self;
+  return 1;
+}
+
+void ctl_mutex_unlock(CTL_MUTEX_t *m){
+  if(m->lock_count==0 || --m->lock_count){
+    return;
+  }
+  m->locking_task=NULL;
+  cpu_changed();
+  //on the MSP430 a waiting task with higher priority would run now
+  cpu_yield();
+}
@@ -0,0 +1,99 @@
+#ifndef __CTL_API_H
+#define __CTL_API_H
+
+//Host port of the parts of the CrossWorks tasking library used by this program
+//tasks run as threads but only the task holding the CPU lock runs, like on
+//the MSP430. the lock is given up in blocking calls and when a mutex is
+//unlocked so other tasks get to run
+
+//CrossWorks keyword for functions that never return
+#define __toplevel
+
+typedef unsigned long CTL_TIME_t;
+typedef unsigned CTL_EVENT_SET_t;
+
+enum{CTL_TIMEOUT_NONE=0,CTL_TIMEOUT_INFINITE=0,CTL_TIMEOUT_ABSOLUTE,CTL_TIMEOUT_DELAY,CTL_TIMEOUT_NOW};
+typedef int CTL_TIMEOUT_t;
+
+enum{CTL_EVENT_WAIT_ANY_EVENTS,CTL_EVENT_WAIT_ANY_EVENTS_WITH_AUTO_CLEAR,CTL_EVENT_WAIT_ALL_EVENTS,CTL_EVENT_WAIT_ALL_EVENTS_WITH_AUTO_CLEAR};
+
+#define CTL_STATE_RUNNABLE                    0x00
+#define CTL_STATE_TIMER_WAIT                  0x01
+#define CTL_STATE_EVENT_WAIT_ALL              0x02
+#define CTL_STATE_EVENT_WAIT_ALL_AC           0x04
+#define CTL_STATE_EVENT_WAIT_ANY              0x06
+#define CTL_STATE_EVENT_WAIT_ANY_AC           0x08
+#define CTL_STATE_SEMAPHORE_WAIT              0x0A
+#define CTL_STATE_MESSAGE_QUEUE_POST_WAIT     0x0C
+#define CTL_STATE_MESSAGE_QUEUE_RECEIVE_WAIT  0x0E
+#define CTL_STATE_MUTEX_WAIT                  0x10
+#define CTL_STATE_SUSPENDED                   0x80
+
+//task control block, same fields as the MSP430 library
+typedef struct CTL_TASK_s{
+  unsigned *stack_pointer;
+  unsigned char priority;
+  unsigned char state;
+  unsigned char reserved;
+  struct CTL_TASK_s *next;
+  CTL_TIME_t timeout;
+  void *wait_object;
+  CTL_EVENT_SET_t wait_events;
+  int thread_errno;
+  void *data;
+  CTL_TIME_t execution_time;
+  unsigned *stack_start;
+  const char *name;
+}CTL_TASK_t;
+
+typedef struct{
+  void **q;
+  unsigned s,front,n;
+  CTL_EVENT_SET_t *e;
+  CTL_EVENT_SET_t notempty,notfull;
+}CTL_MESSAGE_QUEUE_t;
+
+typedef struct{
+  unsigned lock_count;
+  CTL_TASK_t *locking_task;
+  unsigned locking_task_priority;
+}CTL_MUTEX_t;
+
+extern CTL_TASK_t *ctl_task_executing;
+extern CTL_TASK_t *ctl_task_list;
+extern CTL_TIME_t ctl_timeslice_period;
+
+//make the calling thread a task, used for main
+void ctl_task_init(CTL_TASK_t *task,unsigned char priority,const char *name);
+void ctl_task_run(CTL_TASK_t *task,unsigned char priority,void (*entrypoint)(void *),void *parameter,const char *name,unsigned stack_size_in_words,unsigned *stack,unsigned call_size_in_words);
+void ctl_task_remove(CTL_TASK_t *task);
+unsigned char ctl_task_set_priority(CTL_TASK_t *task,unsigned char priority);
+void ctl_task_reschedule(void);
+
+int ctl_global_interrupts_set(int enable);
+
+CTL_TIME_t ctl_get_current_time(void);
+void ctl_timeout_wait(CTL_TIME_t t);
+
+void ctl_events_init(CTL_EVENT_SET_t *e,CTL_EVENT_SET_t set);
+void ctl_events_set_clear(CTL_EVENT_SET_t *e,CTL_EVENT_SET_t set,CTL_EVENT_SET_t clear);
+unsigned ctl_events_wait(int type,CTL_EVENT_SET_t *e,CTL_EVENT_SET_t events,int timeout_type,CTL_TIME_t timeout);
+
+void ctl_message_queue_init(CTL_MESSAGE_QUEUE_t *q,void **queue,unsigned queue_size);
+void ctl_message_queue_setup_events(CTL_MESSAGE_QUEUE_t *q,CTL_EVENT_SET_t *e,CTL_EVENT_SET_t notempty,CTL_EVENT_SET_t notfull);
+unsigned ctl_message_queue_post(CTL_MESSAGE_QUEUE_t *q,void *message,int timeout_type,CTL_TIME_t timeout);
+unsigned ctl_message_queue_post_nb(CTL_MESSAGE_QUEUE_t *q,void *message);
+unsigned ctl_message_queue_receive(CTL_MESSAGE_QUEUE_t *q,void **message,int timeout_type,CTL_TIME_t timeout);
+unsigned ctl_message_queue_receive_nb(CTL_MESSAGE_QUEUE_t *q,void **message);
+unsigned ctl_message_queue_num_used(CTL_MESSAGE_QUEUE_t *q);
+unsigned ctl_message_queue_num_free(CTL_MESSAGE_QUEUE_t *q);
+
+void ctl_mutex_init(CTL_MUTEX_t *m);
+unsigned ctl_mutex_lock(CTL_MUTEX_t *m,int timeout_type,CTL_TIME_t timeout);
+void ctl_mutex_unlock(CTL_MUTEX_t *m);
+
+//host only, give up the CPU lock around a blocking system call
+void ctl_host_release(void);
+void ctl_host_acquire(void);
+
+#endif
@@ -0,0 +1,12 @@
+//Host port of the MSP430F2618 registers used by this program
+#include <msp430.h>
+
+volatile unsigned char P2OUT,P2DIR,P2SEL;
+volatile unsigned char P4OUT,P4DIR,P4SEL;
+volatile unsigned char P5OUT,P5DIR,P5SEL;
+volatile unsigned char P6OUT,P6DIR,P6SEL;
+volatile unsigned char P7OUT,P7DIR,P7SEL;
+volatile unsigned char P8OUT,P8DIR,P8SEL;
+
+//SDlib starts the SPI clock at SMCLK/2
+volatile unsigned char UCA1CTL0,UCA1CTL1,UCA1BR0=2,UCA1BR1,UC1IE;
@@ -0,0 +1,33 @@
+#ifndef __MSP430_H
+#define __MSP430_H
+
+//Host port of the MSP430F2618 registers used by this program
+//registers are plain variables, timer A counts real time
+
+//port registers
+extern volatile unsigned char P2OUT,P2DIR,P2SEL;
+extern volatile unsigned char P4OUT,P4DIR,P4SEL;
+extern volatile unsigned char P5OUT,P5DIR,P5SEL;
+extern volatile unsigned char P6OUT,P6DIR,P6SEL;
+extern volatile unsigned char P7OUT,P7DIR,P7SEL;
+extern volatile unsigned char P8OUT,P8DIR,P8SEL;
+
+//USCI A1 in SPI mode
+extern volatile unsigned char UCA1CTL0,UCA1CTL1,UCA1BR0,UCA1BR1,UC1IE;
+
+//timer A count from the host clock
+short readTA(void);
+#define TAR     ((unsigned short)readTA())
+
+#define BIT0    0x01
+#define BIT1    0x02
+#define BIT2    0x04
+#define BIT3    0x08
+#define BIT4    0x10
+#define BIT5    0x20
+#define BIT6    0x40
+#define BIT7    0x80
+
+#define UCSWRST 0x01
+
+#endif
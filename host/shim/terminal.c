@@ -0,0 +1,74 @@
+//Host port of the termlib command line
+//reads lines, splits them into arguments and runs commands from cmd_tbl
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include "terminal.h"
+
+#define TERM_LINE_LEN     256
+#define TERM_MAX_ARGS     20
+
+//find a command by name
+static const CMD_SPEC *term_find(const char *name){
+  const CMD_SPEC *c;
+  for(c=cmd_tbl;c->name!=NULL;c++){
+    if(!strcmp(c->name,name)){
+      return c;
+    }
+  }
+  return NULL;
+}
+
+int helpCmd(char **argv,unsigned short argc){
+  const CMD_SPEC *c;
+  if(argc==0){
+    printf("Commands :\r\n");
+    for(c=cmd_tbl;c->name!=NULL;c++){
+      printf("  %s\r\n",c->name);
+    }
+    return 0;
+  }
+  if((c=term_find(argv[1]))==NULL){
+    printf("Error : unknown command \"%s\".\r\n",argv[1]);
+    return -1;
+  }
+  printf("%s %s\r\n",c->name,c->helpStr);
+  return 0;
+}
+
+void terminal(void *p){
+  const TERM_SPEC *spec=p;
+  char line[TERM_LINE_LEN],*argv[TERM_MAX_ARGS+1],*ptr;
+  const CMD_SPEC *c;
+  unsigned short argc,len;
+  int ch;
+  printf("%s\r\n",spec->prompt);
+  for(;;){
+    printf(">");
+    //read a line
+    for(len=0;;){
+      ch=spec->getch();
+      if(ch=='\r' || ch=='\n'){
+        break;
+      }
+      if(len<sizeof(line)-1){
+        line[len++]=ch;
+      }
+    }
+    line[len]=0;
+    //split into arguments
+    for(argc=0,ptr=strtok(line," \t");ptr!=NULL && argc<=TERM_MAX_ARGS;ptr=strtok(NULL," \t")){
+      argv[argc++]=ptr;
+    }
+    if(argc==0){
+      continue;
+    }
+    argv[argc]=NULL;
+    if((c=term_find(argv[0]))==NULL){
+      printf("Error : unknown command \"%s\".\r\n",argv[0]);
+      continue;
+    }
+    //commands get the number of arguments after the name
+    c->cmd(argv,argc-1);
+  }
+}
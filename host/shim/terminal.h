@@ -0,0 +1,28 @@
+#ifndef __TERMINAL_H
+#define __TERMINAL_H
+
+//Host port of the termlib command line
+
+//command table entry
+typedef struct{
+  const char *name;
+  const char *helpStr;
+  int (*cmd)(char **argv,unsigned short argc);
+}CMD_SPEC;
+
+//terminal setup, message printed at startup and function to read characters
+typedef struct{
+  const char *prompt;
+  int (*getch)(void);
+}TERM_SPEC;
+
+//command table supplied by the program, ends with a NULL name
+extern const CMD_SPEC cmd_tbl[];
+
+//print list of commands or help for one command
+int helpCmd(char **argv,unsigned short argc);
+
+//run the command line, p points to a TERM_SPEC
+void terminal(void *p);
+
+#endif
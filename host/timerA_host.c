@@ -0,0 +1,45 @@
+//Host version of timerA.c, timestamps come from the host clock
+//scaled to the nominal 32768Hz timer A clock
+#define _POSIX_C_SOURCE 200809L
+#include <time.h>
+#include "../timerA.h"
+
+//calibrated timer A frequency
+unsigned long TA_freq=TA_FREQ_NOMINAL;
+
+static unsigned long long TA_start;
+
+//current time in timer A ticks
+static unsigned long long TA_now(void){
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return ((unsigned long long)ts.tv_sec*TA_FREQ_NOMINAL)+((unsigned long long)ts.tv_nsec*TA_FREQ_NOMINAL)/1000000000ULL;
+}
+
+short readTA(void){
+  return (short)(TA_now()-TA_start);
+}
+
+void init_timerA(void){
+  TA_start=TA_now();
+}
+
+void start_timerA(void){
+}
+
+//timestamps wrap at 32 bits like on the MSP430
+unsigned long TA_time(void){
+  return (TA_now()-TA_start)&0xFFFFFFFFUL;
+}
+
+unsigned long TA_elapsed(unsigned long start){
+  return (TA_time()-start)&0xFFFFFFFFUL;
+}
+
+unsigned long TA_ticks_to_us(unsigned long ticks){
+  return (ticks/TA_freq)*1000000UL+((ticks%TA_freq)*15625UL)/(TA_freq/64);
+}
+
+unsigned long TA_ticks_to_ms(unsigned long ticks){
+  return (ticks/TA_freq)*1000UL+((ticks%TA_freq)*1000UL)/TA_freq;
+}
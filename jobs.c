@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <string.h>
+#include <ctl_api.h>
+#include "jobs.h"
+#include "timerA.h"
+
+//event to start a job
+#define JOB_EV_START    0x01
+
+static CTL_EVENT_SET_t job_evt;
+static CTL_TASK_t *job_tcb;
+static JOB job;
+
+//copy of the command line
+static char job_args[JOB_ARG_LEN];
+
+//setup job state, must be called before tasks are started
+void job_init(CTL_TASK_t *task){
+  ctl_events_init(&job_evt,0);
+  job_tcb=task;
+  memset(&job,0,sizeof(job));
+}
+
+//copy a command line and start it in the job task
+int job_start(const CMD_SPEC *cmd,char **argv,unsigned short argc){
+  unsigned short i,len,pos;
+  if(job.running){
+    return 1;
+  }
+  if(argc>JOB_MAX_ARGS){
+    return 2;
+  }
+  //arguments point into the terminal buffer so copy them
+  for(i=0,pos=0;i<=argc;i++){
+    len=strlen(argv[i])+1;
+    if(pos+len>sizeof(job_args)){
+      return 3;
+    }
+    memcpy(job_args+pos,argv[i],len);
+    job.argv[i]=job_args+pos;
+    pos+=len;
+  }
+  job.argv[i]=NULL;
+  job.argc=argc;
+  job.cmd=cmd;
+  job.cancel=0;
+  job.total=0;
+  job.done=0;
+  job.lba=0;
+  job.started=TA_time();
+  job.running=1;
+  ctl_events_set_clear(&job_evt,JOB_EV_START,0);
+  return 0;
+}
+
+//ask the running job to stop
+int job_kill(void){
+  if(!job.running){
+    return 1;
+  }
+  job.cancel=1;
+  return 0;
+}
+
+//get the current job state
+const JOB *job_get(void){
+  return &job;
+}
+
+//set the number of blocks the command will transfer
+void job_begin(unsigned long total){
+  if(ctl_task_executing==job_tcb){
+    job.total=total;
+    job.done=0;
+  }
+}
+
+//add blocks done and set the current block
+void job_update(unsigned long lba,unsigned long blocks){
+  if(ctl_task_executing==job_tcb){
+    job.lba=lba;
+    job.done+=blocks;
+  }
+}
+
+//check if the job should stop
+int job_cancelled(void){
+  return ctl_task_executing==job_tcb && job.cancel;
+}
+
+//task that runs background jobs
+void job_task(void *p) __toplevel{
+  for(;;){
+    ctl_events_wait(CTL_EVENT_WAIT_ANY_EVENTS_WITH_AUTO_CLEAR,&job_evt,JOB_EV_START,CTL_TIMEOUT_NONE,0);
+    job.result=job.cmd->cmd(job.argv,job.argc);
+    printf("\r\njob \"%s\" %s, returned %i\r\n",job.argv[0],job.cancel?"killed":"finished",job.result);
+    job.running=0;
+  }
+}
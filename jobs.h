@@ -0,0 +1,55 @@
+#ifndef __JOBS_H
+#define __JOBS_H
+
+#include <ctl_api.h>
+#include "terminal.h"
+
+//space for a copy of the command line of a job
+#define JOB_ARG_LEN     80
+#define JOB_MAX_ARGS    10
+
+//returned by long running functions when the job was killed
+#define JOB_CANCELLED   (-1)
+
+//state of the background job
+typedef struct{
+  const CMD_SPEC *cmd;
+  char *argv[JOB_MAX_ARGS+1];
+  unsigned short argc;
+  //set while the job runs
+  volatile unsigned char running;
+  //set by job_kill, checked by the command
+  volatile unsigned char cancel;
+  //return value of the last job
+  int result;
+  //progress reported by the command
+  volatile unsigned long total,done,lba;
+  //timer A timestamp when the job started
+  unsigned long started;
+}JOB;
+
+//setup job state, must be called before tasks are started
+void job_init(CTL_TASK_t *task);
+
+//copy a command line and start it in the job task
+//returns nonzero if a job is already running
+int job_start(const CMD_SPEC *cmd,char **argv,unsigned short argc);
+
+//ask the running job to stop, returns nonzero if no job is running
+int job_kill(void);
+
+//get the current job state
+const JOB *job_get(void);
+
+//functions for commands to report progress, they do nothing outside the job task
+//set the number of blocks the command will transfer
+void job_begin(unsigned long total);
+//add blocks done and set the current block
+void job_update(unsigned long lba,unsigned long blocks);
+//check if the job should stop, always zero outside the job task
+int job_cancelled(void);
+
+//task that runs background jobs
+void job_task(void *p);
+
+#endif
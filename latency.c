@@ -0,0 +1,75 @@
+#include <stdio.h>
+#include <string.h>
+#include "timerA.h"
+#include "latency.h"
+
+//clear latency statistics
+void lat_init(LAT_STATS *s){
+  memset(s,0,sizeof(LAT_STATS));
+  s->min=0xFFFFFFFF;
+}
+
+//add a sample to latency statistics
+void lat_add(LAT_STATS *s,unsigned long ticks){
+  unsigned long v;
+  int b;
+  s->count++;
+  s->sum+=ticks;
+  if(ticks<s->min){
+    s->min=ticks;
+  }
+  if(ticks>s->max){
+    s->max=ticks;
+  }
+  //find bucket from the position of the highest set bit
+  for(b=0,v=ticks;v && b<LAT_BUCKETS-1;b++){
+    v>>=1;
+  }
+  s->hist[b]++;
+}
+
+//estimate the pct percentile from the histogram
+unsigned long lat_percentile(const LAT_STATS *s,unsigned short pct){
+  unsigned long target,cnt,lo,hi;
+  int b;
+  if(s->count==0){
+    return 0;
+  }
+  //number of samples at or below the percentile
+  target=(s->count*pct+99)/100;
+  if(target==0){
+    target=1;
+  }
+  for(b=0,cnt=0;b<LAT_BUCKETS;b++){
+    if(cnt+s->hist[b]>=target){
+      break;
+    }
+    cnt+=s->hist[b];
+  }
+  if(b==0){
+    return 0;
+  }
+  //bucket range
+  lo=1UL<<(b-1);
+  hi=(b==LAT_BUCKETS-1)?s->max:(1UL<<b)-1;
+  //interpolate within the bucket
+  lo+=((hi-lo)*(target-cnt))/s->hist[b];
+  //clamp to observed values
+  if(lo<s->min){
+    lo=s->min;
+  }
+  if(lo>s->max){
+    lo=s->max;
+  }
+  return lo;
+}
+
+//print min/avg/max and percentiles in microseconds
+void lat_print(const LAT_STATS *s){
+  if(s->count==0){
+    printf("no samples\r\n");
+    return;
+  }
+  printf("latency (us) min %lu avg %lu max %lu\r\n",TA_ticks_to_us(s->min),TA_ticks_to_us(s->sum/s->count),TA_ticks_to_us(s->max));
+  printf("percentile (us) 50%% %lu 90%% %lu 99%% %lu\r\n",TA_ticks_to_us(lat_percentile(s,50)),TA_ticks_to_us(lat_percentile(s,90)),TA_ticks_to_us(lat_percentile(s,99)));
+}
@@ -0,0 +1,29 @@
+#ifndef __LATENCY_H
+#define __LATENCY_H
+
+//number of histogram buckets, bucket 0 is for zero and bucket n
+//holds values from 2^(n-1) to 2^n-1, the last bucket also holds
+//everything larger
+#define LAT_BUCKETS     17
+
+//latency statistics in timer A ticks
+typedef struct{
+  unsigned long count;
+  unsigned long sum;
+  unsigned long min,max;
+  unsigned long hist[LAT_BUCKETS];
+}LAT_STATS;
+
+//clear latency statistics
+void lat_init(LAT_STATS *s);
+
+//add a sample to latency statistics
+void lat_add(LAT_STATS *s,unsigned long ticks);
+
+//estimate the pct percentile from the histogram
+unsigned long lat_percentile(const LAT_STATS *s,unsigned short pct);
+
+//print min/avg/max and percentiles in microseconds
+void lat_print(const LAT_STATS *s);
+
+#endif
@@ -7,14 +7,36 @@
 #include <SDlib.h>
 #include "timerA.h"
 #include "terminal.h"
+#include "SDcache.h"
+#include "SDtask.h"
+#include "SDstat.h"
+#include "profile.h"
+#include "stackmon.h"
+#include "cardinfo.h"
+#include "errlog.h"
+#include "jobs.h"
 #include <Error.h>
 
-CTL_TASK_t tasks[3];
+CTL_TASK_t tasks[7];
 
 //stacks for tasks
 unsigned stack1[1+200+1];          
 unsigned stack2[1+700+1];
 unsigned stack3[1+300+1];   
+unsigned stack4[1+300+1];
+unsigned stack5[1+200+1];
+unsigned stack6[1+150+1];
+unsigned stack7[1+400+1];
+
+//stacks for high water mark checks
+const STACK_INFO task_stacks[]={{&tasks[0],stack1,sizeof(stack1)/sizeof(stack1[0])},
+                                {&tasks[1],stack2,sizeof(stack2)/sizeof(stack2[0])},
+                                {&tasks[2],stack3,sizeof(stack3)/sizeof(stack3[0])},
+                                {&tasks[3],stack4,sizeof(stack4)/sizeof(stack4[0])},
+                                {&tasks[4],stack5,sizeof(stack5)/sizeof(stack5[0])},
+                                {&tasks[5],stack6,sizeof(stack6)/sizeof(stack6[0])},
+                                {&tasks[6],stack7,sizeof(stack7)/sizeof(stack7[0])},
+                                {NULL,NULL,0}};
 
 CTL_EVENT_SET_t cmd_parse_evt;
 
@@ -150,10 +172,16 @@ void sd_term(void *p) __toplevel{
     ctl_timeout_wait(ctl_get_current_time()+1024);
   }
   //setup the SD card
-  resp=mmcInit_card();
+  resp=io_mmcInit_card();
   //check response
   if(resp==MMC_SUCCESS){
     printf("\rSD Card Initialized\r\n");
+    //choose I/O settings for this card
+    card_probe();
+    //find the end of the error log
+    if((resp=errlog_start())!=MMC_SUCCESS){
+      printf("Error finding end of error log : %s\r\n",SD_error_str(resp));
+    }
     #ifndef ACDS_BUILD
       P7OUT|=BIT7;
     #endif
@@ -176,8 +204,30 @@ int main(void){
   
   //setup system specific peripherals
 
+  //setup timer A for timestamps
+  init_timerA();
+  start_timerA();
+
   //setup mmc interface
   mmcInit_msp();
+
+  //setup sector cache
+  cache_init();
+
+  //setup SD request queues
+  SDtask_init();
+
+  //setup card lock and clear SD operation statistics
+  io_init();
+
+  //setup CPU profiler
+  prof_init();
+
+  //setup error log staging
+  errlog_init();
+
+  //setup background jobs
+  job_init(&tasks[6]);
   
   //TESTING: set log level to report everything by default
   set_error_level(0);
@@ -243,12 +293,36 @@ int main(void){
   memset(stack3,0xcd,sizeof(stack3));  // write known values into the stack
   stack3[0]=stack3[sizeof(stack3)/sizeof(stack3[0])-1]=0xfeed; // put marker values at the words before/after the stack
 
+  memset(stack4,0xcd,sizeof(stack4));  // write known values into the stack
+  stack4[0]=stack4[sizeof(stack4)/sizeof(stack4[0])-1]=0xfeed; // put marker values at the words before/after the stack
+
+  memset(stack5,0xcd,sizeof(stack5));  // write known values into the stack
+  stack5[0]=stack5[sizeof(stack5)/sizeof(stack5[0])-1]=0xfeed; // put marker values at the words before/after the stack
+
+  memset(stack6,0xcd,sizeof(stack6));  // write known values into the stack
+  stack6[0]=stack6[sizeof(stack6)/sizeof(stack6[0])-1]=0xfeed; // put marker values at the words before/after the stack
+
+  memset(stack7,0xcd,sizeof(stack7));  // write known values into the stack
+  stack7[0]=stack7[sizeof(stack7)/sizeof(stack7[0])-1]=0xfeed; // put marker values at the words before/after the stack
+
   //create tasks
   ctl_task_run(&tasks[0],BUS_PRI_LOW,cmd_parse,NULL,"cmd_parse",sizeof(stack1)/sizeof(stack1[0])-2,stack1+1,0);
  
   ctl_task_run(&tasks[1],BUS_PRI_NORMAL,sd_term,(void*)&async_term,"terminal",sizeof(stack2)/sizeof(stack2[0])-2,stack2+1,0);
 
   ctl_task_run(&tasks[2],BUS_PRI_HIGH,sub_events,NULL,"sub_events",sizeof(stack3)/sizeof(stack3[0])-2,stack3+1,0);
+
+  //SD task runs above the terminal so queued requests are served right away
+  ctl_task_run(&tasks[3],BUS_PRI_NORMAL+1,sd_server,NULL,"sd_server",sizeof(stack4)/sizeof(stack4[0])-2,stack4+1,0);
+
+  //profiler runs above the tasks it measures so it reports under load, it sleeps between windows
+  ctl_task_run(&tasks[4],BUS_PRI_NORMAL+2,prof_task,NULL,"profiler",sizeof(stack5)/sizeof(stack5[0])-2,stack5+1,0);
+
+  //error log writes run in the background below everything else
+  ctl_task_run(&tasks[5],BUS_PRI_LOW,errlog_task,NULL,"errlog",sizeof(stack6)/sizeof(stack6[0])-2,stack6+1,0);
+
+  //background jobs run below the terminal so the console stays responsive
+  ctl_task_run(&tasks[6],BUS_PRI_NORMAL-1,job_task,NULL,"job",sizeof(stack7)/sizeof(stack7[0])-2,stack7+1,0);
   
   mainLoop();
 }
@@ -0,0 +1,186 @@
+#include <string.h>
+#include "pattern.h"
+
+//next state table for the LFSR x^8 + x^6 + x^5 + x^4 + 1
+//generated from the Galois LFSR: (v>>1)^(-(v&1)&0xB8)
+//code taken from: http://en.wikipedia.org/wiki/Linear_feedback_shift_register#Galois_LFSRs
+const unsigned char lfsr_next[256]={
+  0x00,0xB8,0x01,0xB9,0x02,0xBA,0x03,0xBB,0x04,0xBC,0x05,0xBD,0x06,0xBE,0x07,0xBF,
+  0x08,0xB0,0x09,0xB1,0x0A,0xB2,0x0B,0xB3,0x0C,0xB4,0x0D,0xB5,0x0E,0xB6,0x0F,0xB7,
+  0x10,0xA8,0x11,0xA9,0x12,0xAA,0x13,0xAB,0x14,0xAC,0x15,0xAD,0x16,0xAE,0x17,0xAF,
+  0x18,0xA0,0x19,0xA1,0x1A,0xA2,0x1B,0xA3,0x1C,0xA4,0x1D,0xA5,0x1E,0xA6,0x1F,0xA7,
+  0x20,0x98,0x21,0x99,0x22,0x9A,0x23,0x9B,0x24,0x9C,0x25,0x9D,0x26,0x9E,0x27,0x9F,
+  0x28,0x90,0x29,0x91,0x2A,0x92,0x2B,0x93,0x2C,0x94,0x2D,0x95,0x2E,0x96,0x2F,0x97,
+  0x30,0x88,0x31,0x89,0x32,0x8A,0x33,0x8B,0x34,0x8C,0x35,0x8D,0x36,0x8E,0x37,0x8F,
+  0x38,0x80,0x39,0x81,0x3A,0x82,0x3B,0x83,0x3C,0x84,0x3D,0x85,0x3E,0x86,0x3F,0x87,
+  0x40,0xF8,0x41,0xF9,0x42,0xFA,0x43,0xFB,0x44,0xFC,0x45,0xFD,0x46,0xFE,0x47,0xFF,
+  0x48,0xF0,0x49,0xF1,0x4A,0xF2,0x4B,0xF3,0x4C,0xF4,0x4D,0xF5,0x4E,0xF6,0x4F,0xF7,
+  0x50,0xE8,0x51,0xE9,0x52,0xEA,0x53,0xEB,0x54,0xEC,0x55,0xED,0x56,0xEE,0x57,0xEF,
+  0x58,0xE0,0x59,0xE1,0x5A,0xE2,0x5B,0xE3,0x5C,0xE4,0x5D,0xE5,0x5E,0xE6,0x5F,0xE7,
+  0x60,0xD8,0x61,0xD9,0x62,0xDA,0x63,0xDB,0x64,0xDC,0x65,0xDD,0x66,0xDE,0x67,0xDF,
+  0x68,0xD0,0x69,0xD1,0x6A,0xD2,0x6B,0xD3,0x6C,0xD4,0x6D,0xD5,0x6E,0xD6,0x6F,0xD7,
+  0x70,0xC8,0x71,0xC9,0x72,0xCA,0x73,0xCB,0x74,0xCC,0x75,0xCD,0x76,0xCE,0x77,0xCF,
+  0x78,0xC0,0x79,0xC1,0x7A,0xC2,0x7B,0xC3,0x7C,0xC4,0x7D,0xC5,0x7E,0xC6,0x7F,0xC7
+};
+
+//the LFSR is maximal length so every nonzero state is on one cycle of
+//length 255. these tables map a state to its position on the cycle
+//starting from state 1 and back so jumps are a table lookup
+#define LFSR_PERIOD     255
+
+//position of each state on the cycle, zero is not on the cycle
+static const unsigned char lfsr_log[256]={
+  0x00,0x00,0xFE,0x18,0xFD,0x30,0x17,0xC4,0xFC,0xDC,0x2F,0x65,0x16,0xEB,0xC3,0x48,
+  0xFB,0x60,0xDB,0xBD,0x2E,0x89,0x64,0x04,0x15,0x0A,0xEA,0xF4,0xC2,0x7D,0x47,0x6D,
+  0xFA,0x85,0x5F,0xB0,0xDA,0x8E,0xBC,0x95,0x2D,0x1F,0x88,0x22,0x63,0x0D,0x03,0xDF,
+  0x14,0x2A,0x09,0x78,0xE9,0xD5,0xF3,0x73,0xC1,0x1C,0x7C,0xB4,0x46,0x40,0x6C,0xA1,
+  0xF9,0xB9,0x84,0x3C,0x5E,0xCA,0xAF,0x58,0xD9,0x92,0x8D,0x34,0xBB,0xCC,0x94,0xCE,
+  0x2C,0xD7,0x1E,0x42,0x87,0x90,0x21,0x0F,0x62,0x8B,0x0C,0x7F,0x02,0x32,0xDE,0xED,
+  0x13,0x5C,0x29,0x9D,0x08,0xC8,0x77,0x99,0xE8,0xAD,0xD4,0x4E,0xF2,0x56,0x72,0xA6,
+  0xC0,0xF7,0x1B,0x68,0x7B,0xB7,0xB3,0x25,0x45,0x82,0x3F,0x37,0x6B,0x3A,0xA0,0x51,
+  0xF8,0x69,0xB8,0x26,0x83,0x38,0x3B,0x52,0x5D,0x9E,0xC9,0x9A,0xAE,0x4F,0x57,0xA7,
+  0xD8,0x43,0x91,0x10,0x8C,0x80,0x33,0xEE,0xBA,0x3D,0xCB,0x59,0x93,0x35,0xCD,0xCF,
+  0x2B,0x79,0xD6,0x74,0x1D,0xB5,0x41,0xA2,0x86,0xB1,0x8F,0x96,0x20,0x23,0x0E,0xE0,
+  0x61,0xBE,0x8A,0x05,0x0B,0xF5,0x7E,0x6E,0x01,0x19,0x31,0xC5,0xDD,0x66,0xEC,0x49,
+  0x12,0xF0,0x5B,0xD1,0x28,0x54,0x9C,0xA9,0x07,0x70,0xC7,0x4B,0x76,0xA4,0x98,0xE2,
+  0xE7,0xE6,0xAC,0xE5,0xD3,0xAB,0x4D,0xE4,0xF1,0xD2,0x55,0xAA,0x71,0x4C,0xA5,0xE3,
+  0xBF,0x06,0xF6,0x6F,0x1A,0xC6,0x67,0x4A,0x7A,0x75,0xB6,0xA3,0xB2,0x97,0x24,0xE1,
+  0x44,0x11,0x81,0xEF,0x3E,0x5A,0x36,0xD0,0x6A,0x27,0x39,0x53,0x9F,0x9B,0x50,0xA8
+};
+
+//state at each position on the cycle
+static const unsigned char lfsr_exp[LFSR_PERIOD]={
+  0x01,0xB8,0x5C,0x2E,0x17,0xB3,0xE1,0xC8,0x64,0x32,0x19,0xB4,0x5A,0x2D,0xAE,0x57,
+  0x93,0xF1,0xC0,0x60,0x30,0x18,0x0C,0x06,0x03,0xB9,0xE4,0x72,0x39,0xA4,0x52,0x29,
+  0xAC,0x56,0x2B,0xAD,0xEE,0x77,0x83,0xF9,0xC4,0x62,0x31,0xA0,0x50,0x28,0x14,0x0A,
+  0x05,0xBA,0x5D,0x96,0x4B,0x9D,0xF6,0x7B,0x85,0xFA,0x7D,0x86,0x43,0x99,0xF4,0x7A,
+  0x3D,0xA6,0x53,0x91,0xF0,0x78,0x3C,0x1E,0x0F,0xBF,0xE7,0xCB,0xDD,0xD6,0x6B,0x8D,
+  0xFE,0x7F,0x87,0xFB,0xC5,0xDA,0x6D,0x8E,0x47,0x9B,0xF5,0xC2,0x61,0x88,0x44,0x22,
+  0x11,0xB0,0x58,0x2C,0x16,0x0B,0xBD,0xE6,0x73,0x81,0xF8,0x7C,0x3E,0x1F,0xB7,0xE3,
+  0xC9,0xDC,0x6E,0x37,0xA3,0xE9,0xCC,0x66,0x33,0xA1,0xE8,0x74,0x3A,0x1D,0xB6,0x5B,
+  0x95,0xF2,0x79,0x84,0x42,0x21,0xA8,0x54,0x2A,0x15,0xB2,0x59,0x94,0x4A,0x25,0xAA,
+  0x55,0x92,0x49,0x9C,0x4E,0x27,0xAB,0xED,0xCE,0x67,0x8B,0xFD,0xC6,0x63,0x89,0xFC,
+  0x7E,0x3F,0xA7,0xEB,0xCD,0xDE,0x6F,0x8F,0xFF,0xC7,0xDB,0xD5,0xD2,0x69,0x8C,0x46,
+  0x23,0xA9,0xEC,0x76,0x3B,0xA5,0xEA,0x75,0x82,0x41,0x98,0x4C,0x26,0x13,0xB1,0xE0,
+  0x70,0x38,0x1C,0x0E,0x07,0xBB,0xE5,0xCA,0x65,0x8A,0x45,0x9A,0x4D,0x9E,0x4F,0x9F,
+  0xF7,0xC3,0xD9,0xD4,0x6A,0x35,0xA2,0x51,0x90,0x48,0x24,0x12,0x09,0xBC,0x5E,0x2F,
+  0xAF,0xEF,0xCF,0xDF,0xD7,0xD3,0xD1,0xD0,0x68,0x34,0x1A,0x0D,0xBE,0x5F,0x97,0xF3,
+  0xC1,0xD8,0x6C,0x36,0x1B,0xB5,0xE2,0x71,0x80,0x40,0x20,0x10,0x08,0x04,0x02
+};
+
+//return next value in data sequence
+unsigned char dat_next(unsigned char v,int type){
+  switch(type){
+    //next value in the LFSR sequence
+    case DAT_LFSR:
+      return lfsr_next[v];
+    //count up by one
+    case DAT_COUNT:
+      return v+1;
+    //unknown type return zero
+    default:
+      return 0;
+  }
+}
+
+//fill a block with pattern data starting at v
+unsigned char fill_sector(unsigned char *buf,unsigned char v,int type){
+  unsigned short i;
+  switch(type){
+    case DAT_LFSR:
+      //unrolled by four to cut loop overhead
+      for(i=PAT_BLOCK_SIZE/4;i;i--){
+        *buf++=v;
+        v=lfsr_next[v];
+        *buf++=v;
+        v=lfsr_next[v];
+        *buf++=v;
+        v=lfsr_next[v];
+        *buf++=v;
+        v=lfsr_next[v];
+      }
+    return v;
+    case DAT_COUNT:
+      for(i=PAT_BLOCK_SIZE/4;i;i--){
+        *buf++=v++;
+        *buf++=v++;
+        *buf++=v++;
+        *buf++=v++;
+      }
+    return v;
+    default:
+      memset(buf,0,PAT_BLOCK_SIZE);
+    return 0;
+  }
+}
+
+//compare a block to pattern data starting at *v
+unsigned short verify_sector(const unsigned char *buf,unsigned char *v,int type){
+  unsigned short i,count=0;
+  unsigned char val=*v;
+  switch(type){
+    case DAT_LFSR:
+      for(i=PAT_BLOCK_SIZE/4;i;i--){
+        count+=(*buf++!=val);
+        val=lfsr_next[val];
+        count+=(*buf++!=val);
+        val=lfsr_next[val];
+        count+=(*buf++!=val);
+        val=lfsr_next[val];
+        count+=(*buf++!=val);
+        val=lfsr_next[val];
+      }
+    break;
+    case DAT_COUNT:
+      for(i=PAT_BLOCK_SIZE/4;i;i--){
+        count+=(*buf++!=val++);
+        count+=(*buf++!=val++);
+        count+=(*buf++!=val++);
+        count+=(*buf++!=val++);
+      }
+    break;
+    default:
+      for(i=PAT_BLOCK_SIZE;i;i--){
+        count+=(*buf++!=0);
+      }
+      val=0;
+    break;
+  }
+  *v=val;
+  return count;
+}
+
+//return pattern state after n steps from v
+unsigned char pat_jump(unsigned char v,unsigned long n,int type){
+  unsigned short idx;
+  switch(type){
+    case DAT_LFSR:
+      //zero is a fixed point of the LFSR
+      if(v==0){
+        return 0;
+      }
+      idx=lfsr_log[v]+(unsigned short)(n%LFSR_PERIOD);
+      if(idx>=LFSR_PERIOD){
+        idx-=LFSR_PERIOD;
+      }
+      return lfsr_exp[idx];
+    case DAT_COUNT:
+      return v+(unsigned char)n;
+    default:
+      return 0;
+  }
+}
+
+//return pattern state at the start of a sector
+unsigned char pat_sector_start(unsigned char seed,unsigned long offset,int type){
+  switch(type){
+    case DAT_LFSR:
+      //512 steps per sector is 2 steps mod 255
+      return pat_jump(seed,(offset%LFSR_PERIOD)*2,DAT_LFSR);
+    case DAT_COUNT:
+      //512 steps per sector is 0 steps mod 256
+      return seed;
+    default:
+      return 0;
+  }
+}
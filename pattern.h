@@ -0,0 +1,31 @@
+#ifndef __PATTERN_H
+#define __PATTERN_H
+
+//size of a block filled by the pattern kernels
+#define PAT_BLOCK_SIZE    512
+
+//data types for TstCmd
+enum{DAT_LFSR=0,DAT_COUNT};
+
+//next state table for the LFSR x^8 + x^6 + x^5 + x^4 + 1
+extern const unsigned char lfsr_next[256];
+
+//return next value in data sequence
+unsigned char dat_next(unsigned char v,int type);
+
+//fill a block with pattern data starting at v
+//returns the pattern state for the start of the next block
+unsigned char fill_sector(unsigned char *buf,unsigned char v,int type);
+
+//compare a block to pattern data starting at *v
+//returns the number of mismatched bytes and advances *v to the next block
+unsigned short verify_sector(const unsigned char *buf,unsigned char *v,int type);
+
+//return pattern state after n steps from v
+unsigned char pat_jump(unsigned char v,unsigned long n,int type);
+
+//return pattern state at the start of the sector offset sectors after
+//the sector that started with seed
+unsigned char pat_sector_start(unsigned char seed,unsigned long offset,int type);
+
+#endif
@@ -0,0 +1,128 @@
+#include <stdio.h>
+#include <ctl_api.h>
+#include "profile.h"
+
+//events for profiler task
+enum{PROF_EV_START=0x01,PROF_EV_STOP=0x02};
+
+static CTL_EVENT_SET_t prof_evt;
+
+//background window in ms, zero when stopped
+static volatile unsigned short prof_window=0;
+
+//setup profiler, must be called before tasks are started
+void prof_init(void){
+  ctl_events_init(&prof_evt,0);
+  prof_window=0;
+}
+
+//record execution time of every task
+void prof_snapshot(PROF_SNAP *s){
+  extern CTL_TASK_t *ctl_task_list;
+  CTL_TASK_t *t;
+  int en;
+  //don't let the task list or times change while copying
+  en=ctl_global_interrupts_set(0);
+  s->time=ctl_get_current_time();
+  for(t=ctl_task_list,s->n=0,s->missed=0;t!=NULL;t=t->next){
+    if(s->n>=PROF_MAX_TASKS){
+      s->missed++;
+      continue;
+    }
+    s->ent[s->n].task=t;
+    s->ent[s->n].exec=t->execution_time;
+    s->n++;
+  }
+  ctl_global_interrupts_set(en);
+}
+
+//print CPU usage of each task since a snapshot
+void prof_print(const PROF_SNAP *s){
+  PROF_SNAP now;
+  CTL_TIME_t d[PROF_MAX_TASKS],total=0;
+  unsigned long pct;
+  int i,j;
+  prof_snapshot(&now);
+  //find time used by each task in the window
+  for(i=0;i<now.n;i++){
+    //tasks started after the snapshot count from zero
+    d[i]=now.ent[i].exec;
+    for(j=0;j<s->n;j++){
+      if(s->ent[j].task==now.ent[i].task){
+        d[i]-=s->ent[j].exec;
+        break;
+      }
+    }
+    total+=d[i];
+  }
+  //ticks are 1/1024 sec
+  printf("\r\nCPU usage over %lu ms\r\nName\t\tTicks\tCPU\r\n--------------------------------\r\n",((now.time-s->time)*1000)/1024);
+  for(i=0;i<now.n;i++){
+    //percent with one decimal place
+    pct=total?(d[i]*1000)/total:0;
+    printf("%-10s\t%lu\t%3lu.%lu%%\r\n",now.ent[i].task->name,d[i],pct/10,pct%10);
+  }
+  if(now.missed){
+    //percentages are of the tasks shown
+    printf("%u tasks not shown\r\n",now.missed);
+  }
+  printf("\r\n");
+}
+
+//find ticks used since a snapshot by all tasks and by tasks other then self
+void prof_delta(const PROF_SNAP *s,const CTL_TASK_t *self,CTL_TIME_t *total,CTL_TIME_t *other){
+  PROF_SNAP now;
+  CTL_TIME_t d;
+  int i,j;
+  prof_snapshot(&now);
+  *total=*other=0;
+  for(i=0;i<now.n;i++){
+    d=now.ent[i].exec;
+    for(j=0;j<s->n;j++){
+      if(s->ent[j].task==now.ent[i].task){
+        d-=s->ent[j].exec;
+        break;
+      }
+    }
+    *total+=d;
+    if(now.ent[i].task!=self){
+      *other+=d;
+    }
+  }
+}
+
+//start printing CPU usage every window ms in the background
+void prof_start(unsigned short window){
+  prof_window=window;
+  ctl_events_set_clear(&prof_evt,PROF_EV_START,PROF_EV_STOP);
+}
+
+//stop background printing
+void prof_stop(void){
+  prof_window=0;
+  ctl_events_set_clear(&prof_evt,PROF_EV_STOP,PROF_EV_START);
+}
+
+//return background window in ms or zero if stopped
+unsigned short prof_running(void){
+  return prof_window;
+}
+
+//profiler task, sleeps until started then prints a table every window
+void prof_task(void *p) __toplevel{
+  PROF_SNAP snap;
+  unsigned short window;
+  unsigned int e;
+  for(;;){
+    ctl_events_wait(CTL_EVENT_WAIT_ANY_EVENTS_WITH_AUTO_CLEAR,&prof_evt,PROF_EV_START,CTL_TIMEOUT_NONE,0);
+    while((window=prof_window)!=0){
+      prof_snapshot(&snap);
+      //wait for the window to end or a stop request
+      e=ctl_events_wait(CTL_EVENT_WAIT_ANY_EVENTS_WITH_AUTO_CLEAR,&prof_evt,PROF_EV_STOP,CTL_TIMEOUT_ABSOLUTE,snap.time+((unsigned long)window*1024)/1000);
+      if(e&PROF_EV_STOP || !prof_window){
+        break;
+      }
+      prof_print(&snap);
+    }
+  }
+}
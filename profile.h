@@ -0,0 +1,51 @@
+#ifndef __PROFILE_H
+#define __PROFILE_H
+
+#include <ctl_api.h>
+
+//maximum number of tasks tracked in a snapshot, 7 tasks plus idle
+//are running so this leaves room for a few more
+#define PROF_MAX_TASKS    10
+
+//default and allowed window lengths in ms
+#define PROF_WINDOW_DEFAULT   1000
+#define PROF_WINDOW_MIN       100
+#define PROF_WINDOW_MAX       60000
+
+//execution time of all tasks at one point in time
+typedef struct{
+  CTL_TIME_t time;
+  unsigned short n;
+  //tasks that did not fit
+  unsigned short missed;
+  struct{
+    CTL_TASK_t *task;
+    CTL_TIME_t exec;
+  }ent[PROF_MAX_TASKS];
+}PROF_SNAP;
+
+//setup profiler, must be called before tasks are started
+void prof_init(void);
+
+//record execution time of every task
+void prof_snapshot(PROF_SNAP *s);
+
+//print CPU usage of each task since a snapshot
+void prof_print(const PROF_SNAP *s);
+
+//find ticks used since a snapshot by all tasks and by tasks other then self
+void prof_delta(const PROF_SNAP *s,const CTL_TASK_t *self,CTL_TIME_t *total,CTL_TIME_t *other);
+
+//start printing CPU usage every window ms in the background
+void prof_start(unsigned short window);
+
+//stop background printing
+void prof_stop(void);
+
+//return background window in ms or zero if stopped
+unsigned short prof_running(void);
+
+//profiler task
+void prof_task(void *p);
+
+#endif
@@ -0,0 +1,40 @@
+#include <msp430.h>
+#include <ctl_api.h>
+#include "spiclk.h"
+#include "SDstat.h"
+
+//divider chosen by spitune
+unsigned short spi_tuned_div=0;
+
+//return the UCA1 SPI clock divider
+unsigned short spi_get_div(void){
+  return UCA1BR0|(((unsigned short)UCA1BR1)<<8);
+}
+
+//set the UCA1 SPI clock divider, waits for the card to be idle
+void spi_set_div(unsigned short div){
+  unsigned char ie;
+  int en;
+  if(div<SPI_DIV_MIN){
+    div=SPI_DIV_MIN;
+  }
+  //no transfer can be in progress while the USCI is reset
+  io_card_lock();
+  en=ctl_global_interrupts_set(0);
+  //reset clears the interrupt enables so save them
+  ie=UC1IE;
+  UCA1CTL1|=UCSWRST;
+  UCA1BR0=div;
+  UCA1BR1=div>>8;
+  UCA1CTL1&=~UCSWRST;
+  UC1IE=ie;
+  ctl_global_interrupts_set(en);
+  io_card_unlock();
+}
+
+//set the tuned divider if there is one
+void spi_apply_tuned(void){
+  if(spi_tuned_div){
+    spi_set_div(spi_tuned_div);
+  }
+}
@@ -0,0 +1,20 @@
+#ifndef __SPICLK_H
+#define __SPICLK_H
+
+//fastest divider that can be set, SPI clock is BRCLK/divider
+#define SPI_DIV_MIN     1
+
+//return the UCA1 SPI clock divider
+unsigned short spi_get_div(void);
+
+//set the UCA1 SPI clock divider, waits for the card to be idle
+void spi_set_div(unsigned short div);
+
+//divider chosen by spitune, zero if SDlib's divider is used
+extern unsigned short spi_tuned_div;
+
+//set the tuned divider if there is one, call after the card is initialized
+//because SDlib sets its own divider
+void spi_apply_tuned(void);
+
+#endif
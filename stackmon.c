@@ -0,0 +1,51 @@
+#include <stddef.h>
+#include <ctl_api.h>
+#include "stackmon.h"
+
+//find the stack info for a task, returns NULL if it is not in the table
+const STACK_INFO *stack_find(const CTL_TASK_t *t){
+  const STACK_INFO *s;
+  for(s=task_stacks;s->stack!=NULL;s++){
+    if(s->task==t){
+      return s;
+    }
+  }
+  return NULL;
+}
+
+//peak number of words used, found from the deepest overwritten fill word
+unsigned short stack_peak(const STACK_INFO *s){
+  const unsigned *p=s->stack+1,*top=s->stack+s->words-1;
+  //stack grows down so unused words are at the start
+  while(p<top && *p==STACK_FILL){
+    p++;
+  }
+  return top-p;
+}
+
+//check guard words at both ends of the stack, returns zero if damaged
+int stack_guard_ok(const STACK_INFO *s){
+  return s->stack[0]==STACK_GUARD && s->stack[s->words-1]==STACK_GUARD;
+}
+
+//refill the unused part of every stack so the next peak is for new activity
+void stack_reset(void){
+  const STACK_INFO *s;
+  unsigned *p,*end,here;
+  int en;
+  //other tasks must not run while their stacks are written
+  en=ctl_global_interrupts_set(0);
+  for(s=task_stacks;s->stack!=NULL;s++){
+    if(s->task==ctl_task_executing){
+      //saved stack pointer is stale for the running task, use a local
+      end=&here;
+    }else{
+      end=s->task->stack_pointer;
+    }
+    end-=STACK_MARGIN;
+    for(p=s->stack+1;p<end;p++){
+      *p=STACK_FILL;
+    }
+  }
+  ctl_global_interrupts_set(en);
+}
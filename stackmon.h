@@ -0,0 +1,35 @@
+#ifndef __STACKMON_H
+#define __STACKMON_H
+
+#include <ctl_api.h>
+
+//values written into task stacks by main before tasks start
+#define STACK_FILL      0xcdcd
+#define STACK_GUARD     0xfeed
+
+//words left between the stack pointer and the refilled area
+#define STACK_MARGIN    8
+
+//a task stack, words includes the guard words at each end
+typedef struct{
+  CTL_TASK_t *task;
+  unsigned *stack;
+  unsigned short words;
+}STACK_INFO;
+
+//table of task stacks, ends with a NULL stack
+extern const STACK_INFO task_stacks[];
+
+//find the stack info for a task, returns NULL if it is not in the table
+const STACK_INFO *stack_find(const CTL_TASK_t *t);
+
+//peak number of words used, found from the deepest overwritten fill word
+unsigned short stack_peak(const STACK_INFO *s);
+
+//check guard words at both ends of the stack, returns zero if damaged
+int stack_guard_ok(const STACK_INFO *s);
+
+//refill the unused part of every stack so the next peak is for new activity
+void stack_reset(void);
+
+#endif
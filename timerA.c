@@ -1,5 +1,12 @@
 #include <ctl_api.h>
 #include <msp430.h>
+#include "timerA.h"
+
+//upper 16 bits of the timestamp
+static volatile unsigned short TA_overflow=0;
+
+//calibrated timer A frequency
+unsigned long TA_freq=TA_FREQ_NOMINAL;
 
 //use majority function so the timer
 //can be read while it is running
@@ -7,3 +14,56 @@ short readTA(void){
   int a=TAR,b=TAR,c=TAR;
   return (a&b)|(a&c)|(b&c);
 }
+
+//setup timer A to run off 32.768kHz xtal
+void init_timerA(void){
+  //stop and clear timer, use ACLK, no divider, overflow interrupt
+  TACTL=TASSEL_1|ID_0|MC_0|TACLR|TAIE;
+  TA_overflow=0;
+}
+
+//start timer A in continuous mode
+void start_timerA(void){
+  TACTL|=MC_2;
+}
+
+//get 32-bit timestamp
+unsigned long TA_time(void){
+  unsigned short hi,lo;
+  int en;
+  en=ctl_global_interrupts_set(0);
+  hi=TA_overflow;
+  lo=readTA();
+  //timer may have overflowed before the interrupt could run
+  if((TACTL&TAIFG) && lo<0x8000){
+    hi++;
+  }
+  ctl_global_interrupts_set(en);
+  return (((unsigned long)hi)<<16)|lo;
+}
+
+//ticks since a timestamp from TA_time
+unsigned long TA_elapsed(unsigned long start){
+  return TA_time()-start;
+}
+
+//convert timer A ticks to microseconds
+unsigned long TA_ticks_to_us(unsigned long ticks){
+  //split to avoid overflow, good for about 71 minutes
+  return (ticks/TA_freq)*1000000UL+((ticks%TA_freq)*15625UL)/(TA_freq/64);
+}
+
+//convert timer A ticks to milliseconds
+unsigned long TA_ticks_to_ms(unsigned long ticks){
+  return (ticks/TA_freq)*1000UL+((ticks%TA_freq)*1000UL)/TA_freq;
+}
+
+//count timer overflows
+void timerA_ISR(void) __interrupt[TIMERA1_VECTOR]{
+  switch(TAIV){
+    //overflow
+    case 0x0A:
+      TA_overflow++;
+    break;
+  }
+}
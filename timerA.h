@@ -1,6 +1,9 @@
 #ifndef __TIMER_A_H
 #define __TIMER_A_H
 
+//nominal timer A clock frequency in Hz
+#define TA_FREQ_NOMINAL     32768
+
 //use majority function so the timer
 //can be read while it is running
 short readTA(void);
@@ -11,5 +14,18 @@ void init_timerA(void);
 //start timer A in continuous mode
 void start_timerA(void);
 
+//get 32-bit timestamp, timer A count extended with overflows
+//wraps after about 36 hours
+unsigned long TA_time(void);
+
+//ticks since a timestamp from TA_time
+unsigned long TA_elapsed(unsigned long start);
+
+//calibrated timer A frequency used for conversions
+extern unsigned long TA_freq;
+
+//convert timer A ticks to microseconds and milliseconds
+unsigned long TA_ticks_to_us(unsigned long ticks);
+unsigned long TA_ticks_to_ms(unsigned long ticks);
+
 #endif
-  
\ No newline at end of file
@@ -0,0 +1,24 @@
+#include "hexdump.h"
+#include "crc16.h"
+#include "xfer.h"
+
+//send a frame over the async link
+void xfer_frame(unsigned char type,unsigned short seq,const unsigned char *dat,unsigned short len){
+  unsigned char hdr[2+XFER_HDR_LEN];
+  unsigned short crc;
+  hdr[0]=XFER_SYNC0;
+  hdr[1]=XFER_SYNC1;
+  hdr[2]=type;
+  hdr[3]=seq;
+  hdr[4]=seq>>8;
+  hdr[5]=len;
+  hdr[6]=len>>8;
+  //CRC covers header after sync and payload
+  crc=crc16(CRC16_INIT,hdr+2,XFER_HDR_LEN);
+  crc=crc16(crc,dat,len);
+  term_write((const char*)hdr,sizeof(hdr));
+  term_write((const char*)dat,len);
+  hdr[0]=crc;
+  hdr[1]=crc>>8;
+  term_write((const char*)hdr,2);
+}
@@ -0,0 +1,28 @@
+#ifndef __XFER_H
+#define __XFER_H
+
+//binary framed transfer over the async link
+//frame layout, multi byte fields are little endian:
+//  sync    2 bytes XFER_SYNC0, XFER_SYNC1
+//  type    1 byte
+//  seq     2 bytes
+//  len     2 bytes payload length
+//  payload len bytes
+//  crc     2 bytes CRC-16-CCITT of type through payload
+
+#define XFER_SYNC0      0xA5
+#define XFER_SYNC1      0x5A
+
+//size of header after sync bytes
+#define XFER_HDR_LEN    5
+
+//largest payload
+#define XFER_MAX_LEN    512
+
+//frame types
+enum{XFER_DATA=1,XFER_END,XFER_ERR};
+
+//send a frame over the async link
+void xfer_frame(unsigned char type,unsigned short seq,const unsigned char *dat,unsigned short len);
+
+#endif